@@ -1,8 +1,10 @@
 #include "devices/disk.h"
 #include <ctype.h>
 #include <debug.h>
+#include <rdtsc.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -48,6 +50,10 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
+/* Maximum number of sectors transferred by one command.  A sector
+   count of 0 in the command block stands for this number. */
+#define MAX_SECTORS_PER_CMD 256
+
 /* An ATA device. */
 struct disk 
   {
@@ -58,8 +64,13 @@ struct disk
     bool is_ata;                /* 1=This device is an ATA disk. */
     disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
 
+    const struct disk_ops *ops; /* Non-null for a software disk. */
+    void *aux;                  /* Passed to OPS. */
+
     long long read_cnt;         /* Number of sectors read. */
     long long write_cnt;        /* Number of sectors written. */
+    uint64_t read_cycles;       /* CPU cycles spent reading. */
+    uint64_t write_cycles;      /* CPU cycles spent writing. */
   };
 
 /* An ATA channel (aka controller).
@@ -82,11 +93,15 @@ struct channel
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Software disks that take the place of ATA devices, if any.
+   See disk_register(). */
+static struct disk soft_disks[CHANNEL_CNT][2];
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -159,6 +174,21 @@ disk_init (void)
     }
 }
 
+/* Prints statistics for disk D, if it exists. */
+static void
+print_disk_stats (const struct disk *d) 
+{
+  if (!d->is_ata && d->ops == NULL)
+    return;
+
+  printf ("%s: %lld reads, %lld writes", d->name, d->read_cnt, d->write_cnt);
+  if (d->read_cnt > 0)
+    printf (", %llu cycles/read", d->read_cycles / d->read_cnt);
+  if (d->write_cnt > 0)
+    printf (", %llu cycles/write", d->write_cycles / d->write_cnt);
+  printf ("\n");
+}
+
 /* Prints disk statistics. */
 void
 disk_print_stats (void) 
@@ -171,10 +201,8 @@ disk_print_stats (void)
 
       for (dev_no = 0; dev_no < 2; dev_no++) 
         {
-          struct disk *d = disk_get (chan_no, dev_no);
-          if (d != NULL && d->is_ata) 
-            printf ("%s: %lld reads, %lld writes\n",
-                    d->name, d->read_cnt, d->write_cnt);
+          print_disk_stats (&channels[chan_no].devices[dev_no]);
+          print_disk_stats (&soft_disks[chan_no][dev_no]);
         }
     }
 }
@@ -195,13 +223,48 @@ disk_get (int chan_no, int dev_no)
 
   if (chan_no < (int) CHANNEL_CNT) 
     {
-      struct disk *d = &channels[chan_no].devices[dev_no];
+      struct disk *d = &soft_disks[chan_no][dev_no];
+      if (d->ops != NULL)
+        return d;
+
+      d = &channels[chan_no].devices[dev_no];
       if (d->is_ata)
         return d; 
     }
   return NULL;
 }
 
+/* Makes disk_get (CHAN_NO, DEV_NO) return a software disk named
+   NAME with CAPACITY sectors, which are read and written by OPS,
+   instead of the ATA disk there, if any.  A pointer to the ATA
+   disk obtained from disk_get() beforehand stays valid, so the
+   software disk may store its data there.
+   Returns the new disk. */
+struct disk *
+disk_register (int chan_no, int dev_no, const char *name,
+               disk_sector_t capacity, const struct disk_ops *ops,
+               void *aux) 
+{
+  struct disk *d;
+
+  ASSERT (chan_no >= 0 && chan_no < (int) CHANNEL_CNT);
+  ASSERT (dev_no == 0 || dev_no == 1);
+  ASSERT (ops != NULL);
+
+  d = &soft_disks[chan_no][dev_no];
+  ASSERT (d->ops == NULL);
+  strlcpy (d->name, name, sizeof d->name);
+  d->channel = NULL;
+  d->dev_no = dev_no;
+  d->is_ata = false;
+  d->capacity = capacity;
+  d->ops = ops;
+  d->aux = aux;
+  d->read_cnt = d->write_cnt = 0;
+  d->read_cycles = d->write_cycles = 0;
+  return d;
+}
+
 /* Returns the size of disk D, measured in DISK_SECTOR_SIZE-byte
    sectors. */
 disk_sector_t
@@ -220,19 +283,83 @@ void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) 
 {
   struct channel *c;
+  uint64_t start = rdtsc ();
   
   ASSERT (d != NULL);
   ASSERT (buffer != NULL);
 
+  if (d->ops != NULL)
+    {
+      ASSERT (sec_no < d->capacity);
+      d->ops->read (d->aux, sec_no, buffer);
+      d->read_cnt++;
+      d->read_cycles += rdtsc () - start;
+      return;
+    }
+
   c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
+  select_sector (d, sec_no, 1);
   issue_pio_command (c, CMD_READ_SECTOR_RETRY);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
   input_sector (c, buffer);
   d->read_cnt++;
+  d->read_cycles += rdtsc () - start;
+  lock_release (&c->lock);
+}
+
+/* Reads CNT consecutive sectors starting at SEC_NO from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  For an ATA disk this issues one command per
+   MAX_SECTORS_PER_CMD sectors, instead of one per sector as
+   disk_read() does.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, size_t cnt,
+                    void *buffer_) 
+{
+  uint8_t *buffer = buffer_;
+  struct channel *c;
+
+  ASSERT (d != NULL);
+  ASSERT (buffer != NULL);
+
+  if (d->ops != NULL)
+    {
+      for (; cnt > 0; cnt--, sec_no++, buffer += DISK_SECTOR_SIZE)
+        disk_read (d, sec_no, buffer);
+      return;
+    }
+
+  c = d->channel;
+  lock_acquire (&c->lock);
+  while (cnt > 0) 
+    {
+      uint64_t start = rdtsc ();
+      size_t batch = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+      size_t i;
+
+      select_sector (d, sec_no, batch);
+      issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+      for (i = 0; i < batch; i++) 
+        {
+          /* The disk interrupts once for each sector. */
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          input_sector (c, buffer);
+          buffer += DISK_SECTOR_SIZE;
+        }
+      d->read_cnt += batch;
+      d->read_cycles += rdtsc () - start;
+
+      sec_no += batch;
+      cnt -= batch;
+    }
   lock_release (&c->lock);
 }
 
@@ -245,19 +372,30 @@ void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer)
 {
   struct channel *c;
+  uint64_t start = rdtsc ();
   
   ASSERT (d != NULL);
   ASSERT (buffer != NULL);
 
+  if (d->ops != NULL)
+    {
+      ASSERT (sec_no < d->capacity);
+      d->ops->write (d->aux, sec_no, buffer);
+      d->write_cnt++;
+      d->write_cycles += rdtsc () - start;
+      return;
+    }
+
   c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
+  select_sector (d, sec_no, 1);
   issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy (d))
     PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
   output_sector (c, buffer);
   sema_down (&c->completion_wait);
   d->write_cnt++;
+  d->write_cycles += rdtsc () - start;
   lock_release (&c->lock);
 }
 
@@ -429,15 +567,16 @@ print_ata_string (char *string, size_t size)
    writes SEC_NO to the disk's sector selection registers.  (We
    use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) 
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) 
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < d->capacity);
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_SECTORS_PER_CMD);
+  ASSERT (sec_no < d->capacity && cnt <= d->capacity - sec_no);
+  ASSERT (sec_no + cnt <= (1UL << 28));
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == MAX_SECTORS_PER_CMD ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -2,6 +2,7 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* Size of a disk sector in bytes. */
@@ -21,6 +22,20 @@ void disk_print_stats (void);
 struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
+void disk_read_multiple (struct disk *, disk_sector_t, size_t cnt, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
 
+/* Sector operations of a disk implemented in software, such as
+   a RAM disk, which is registered with disk_register().  AUX is
+   the pointer given to disk_register(). */
+struct disk_ops
+  {
+    void (*read) (void *aux, disk_sector_t, void *);
+    void (*write) (void *aux, disk_sector_t, const void *);
+  };
+
+struct disk *disk_register (int chan_no, int dev_no, const char *name,
+                            disk_sector_t capacity,
+                            const struct disk_ops *, void *aux);
+
 #endif /* devices/disk.h */
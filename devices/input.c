@@ -2,15 +2,20 @@
 #include <debug.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/synch.h"
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+/* Woken whenever a key is added to BUFFER. */
+static struct waitq waiters;
+
 /* Initializes the input buffer. */
 void
 input_init (void) 
 {
   intq_init (&buffer);
+  waitq_init (&waiters);
 }
 
 /* Adds a key to the input buffer.
@@ -23,6 +28,7 @@ input_putc (uint8_t key)
 
   intq_putc (&buffer, key);
   serial_notify ();
+  waitq_wake (&waiters);
 }
 
 /* Retrieves a key from the input buffer.
@@ -50,3 +56,22 @@ input_full (void)
   ASSERT (intr_get_level () == INTR_OFF);
   return intq_full (&buffer);
 }
+
+/* Returns true if the input buffer is empty, so that
+   input_getc() would wait. */
+bool
+input_empty (void)
+{
+  enum intr_level old_level = intr_disable ();
+  bool empty = intq_empty (&buffer);
+  intr_set_level (old_level);
+  return empty;
+}
+
+/* Returns the wait queue that is woken whenever a key is added to
+   the input buffer. */
+struct waitq *
+input_waitq (void)
+{
+  return &waiters;
+}
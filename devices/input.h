@@ -4,9 +4,13 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+struct waitq;
+
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
 bool input_full (void);
+bool input_empty (void);
+struct waitq *input_waitq (void);
 
 #endif /* devices/input.h */
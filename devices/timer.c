@@ -122,6 +122,37 @@ timer_sleep (int64_t ticks)
   free(sleepy);
 }
 
+/* Arranges for SEMA to be upped once TICKS timer ticks have
+   passed, without blocking, unless timer_cancel(SLEEPER) is
+   called first.  SLEEPER must stay allocated until then. */
+void
+timer_alarm (struct sleeper *sleeper, struct semaphore *sema, int64_t ticks)
+{
+  enum intr_level old_level;
+
+  sleeper->ticks = ticks;
+  sleeper->start = timer_ticks ();
+  sleeper->sema = sema;
+
+  old_level = intr_disable ();
+  list_push_back (&sleeper_list, &sleeper->elem);
+  intr_set_level (old_level);
+}
+
+/* Cancels the alarm set with timer_alarm(SLEEPER), if it has
+   not gone off yet. */
+void
+timer_cancel (struct sleeper *sleeper)
+{
+  enum intr_level old_level = intr_disable ();
+  if (sleeper->sema != NULL)
+    {
+      list_remove (&sleeper->elem);
+      sleeper->sema = NULL;
+    }
+  intr_set_level (old_level);
+}
+
 /* Suspends execution for approximately MS milliseconds. */
 void
 timer_msleep (int64_t ms) 
@@ -170,6 +201,7 @@ timer_interrupt (struct intr_frame *args UNUSED)
       sema_up(sleepy->sema);
       /* Delete list item */ 
       e = list_prev(list_remove(e)); 
+      sleepy->sema = NULL;
     }
   }
 
@@ -18,6 +18,11 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+struct sleeper;
+struct semaphore;
+void timer_alarm (struct sleeper *, struct semaphore *, int64_t ticks);
+void timer_cancel (struct sleeper *);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
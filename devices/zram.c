@@ -0,0 +1,562 @@
+#include "devices/zram.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed RAM disks.
+
+   A compressed RAM disk takes the place of an ATA disk (see
+   disk_register()) and keeps its contents in memory, one 4 kB
+   block at a time, compressed with a small LZ77 codec.  Blocks
+   that are all zeros take no memory at all.
+
+   Compressed blocks are stored in a pool of kernel pages, each
+   divided into UNIT_SIZE-byte units; a block occupies
+   consecutive units of a single pool page.  When the pool is
+   full, the least recently used blocks are written out
+   ("spilled") to the ATA disk that the RAM disk replaced, if
+   there is one, and read back from there when needed.
+
+   Sectors are read and written through a one-block cache of
+   uncompressed data, so that the 8 sector accesses that make up
+   a typical page-sized transfer only compress or decompress the
+   block once. */
+
+/* Size of a block. */
+#define BLOCK_SIZE PGSIZE
+#define BLOCK_SECTORS (BLOCK_SIZE / DISK_SECTOR_SIZE)
+#define BLOCK_NONE SIZE_MAX
+
+/* Pool allocation unit. */
+#define UNIT_SIZE 64
+#define PAGE_UNITS (PGSIZE / UNIT_SIZE)
+
+/* Default pool size, in pages, and, for a RAM disk without a disk
+   to spill to, the compression ratio its capacity assumes. */
+#define DEFAULT_POOL_PAGES 128
+#define ASSUMED_RATIO 2
+
+/* Maximum number of RAM disks. */
+#define ZRAM_MAX 4
+
+/* Where a block's data is. */
+enum block_state
+  {
+    BLOCK_ZERO,                 /* All zeros. */
+    BLOCK_POOL,                 /* Compressed in the pool. */
+    BLOCK_SPILLED               /* On the backing disk. */
+  };
+
+/* A block of a RAM disk. */
+struct block
+  {
+    enum block_state state;
+    size_t unit;                /* First pool unit, if in pool. */
+    size_t size;                /* Bytes in pool; BLOCK_SIZE if raw. */
+    struct list_elem lru_elem;  /* Element in LRU list, if in pool. */
+  };
+
+/* A compressed RAM disk. */
+struct zram
+  {
+    int chan_no, dev_no;        /* Position in place of an ATA disk. */
+    size_t pool_limit;          /* Maximum number of pool pages. */
+    struct disk *backing;       /* ATA disk to spill to, or null. */
+
+    struct lock lock;           /* Protects everything below. */
+    struct block *blocks;       /* Blocks of the disk. */
+    size_t block_cnt;           /* Number of blocks. */
+    uint8_t **pool;             /* Pool pages, null until needed. */
+    struct bitmap *units;       /* Used pool units. */
+    struct list lru;            /* Pooled blocks, least recent first. */
+
+    size_t cached;              /* Block in CACHE, or BLOCK_NONE. */
+    bool cache_dirty;           /* CACHE modified since loaded? */
+    uint8_t *cache;             /* Uncompressed block. */
+    uint8_t *out;               /* Compression output. */
+    uint8_t *spill;             /* Decompression buffer for spilling. */
+    uint16_t *table;            /* Compressor hash table. */
+
+    /* Statistics. */
+    long long load_cnt;         /* # of blocks loaded into CACHE. */
+    long long hit_cnt;          /* # of those not read from disk. */
+    long long spill_cnt;        /* # of blocks spilled. */
+    long long in_bytes;         /* Bytes given to the compressor. */
+    long long out_bytes;        /* Bytes stored in the pool. */
+  };
+
+static struct zram devices[ZRAM_MAX];
+static size_t device_cnt;
+
+static void zram_read (void *, disk_sector_t, void *);
+static void zram_write (void *, disk_sector_t, const void *);
+
+static const struct disk_ops zram_ops = { zram_read, zram_write };
+
+static size_t lz_compress (const uint8_t *, uint8_t *, uint16_t *table);
+static void lz_decompress (const uint8_t *, uint8_t *);
+
+/* Arranges for disk CHAN_NO:DEV_NO to be replaced by a
+   compressed RAM disk with a pool of at most POOL_PAGES pages, or
+   a default number if POOL_PAGES is 0, when zram_init() is
+   called.  May be called before memory allocation is set up. */
+void
+zram_configure (int chan_no, int dev_no, size_t pool_pages) 
+{
+  struct zram *z;
+
+  if (device_cnt >= ZRAM_MAX)
+    PANIC ("too many compressed RAM disks");
+  if (chan_no < 0 || chan_no > 1 || dev_no < 0 || dev_no > 1)
+    PANIC ("bad disk %d:%d for compressed RAM disk", chan_no, dev_no);
+
+  z = &devices[device_cnt++];
+  z->chan_no = chan_no;
+  z->dev_no = dev_no;
+  z->pool_limit = pool_pages > 0 ? pool_pages : DEFAULT_POOL_PAGES;
+}
+
+/* Creates the configured RAM disks.  Must be called after
+   disk_init() and before anything uses the disks they
+   replace. */
+void
+zram_init (void) 
+{
+  size_t i, j;
+
+  for (i = 0; i < device_cnt; i++) 
+    {
+      struct zram *z = &devices[i];
+      disk_sector_t capacity;
+      char name[8];
+
+      z->backing = disk_get (z->chan_no, z->dev_no);
+      if (z->backing != NULL)
+        capacity = disk_size (z->backing);
+      else
+        capacity = z->pool_limit * BLOCK_SECTORS * ASSUMED_RATIO;
+
+      lock_init (&z->lock);
+      z->block_cnt = DIV_ROUND_UP (capacity, BLOCK_SECTORS);
+      z->blocks = malloc (z->block_cnt * sizeof *z->blocks);
+      z->pool = calloc (z->pool_limit, sizeof *z->pool);
+      z->units = bitmap_create (z->pool_limit * PAGE_UNITS);
+      z->cache = palloc_get_page (0);
+      z->out = palloc_get_page (0);
+      z->spill = palloc_get_page (0);
+      z->table = palloc_get_page (0);
+      if (z->blocks == NULL || z->pool == NULL || z->units == NULL
+          || z->cache == NULL || z->out == NULL || z->spill == NULL
+          || z->table == NULL)
+        PANIC ("compressed RAM disk: out of memory");
+
+      /* Until a block is written, its data is whatever the disk
+         we replace holds, or zeros. */
+      for (j = 0; j < z->block_cnt; j++)
+        z->blocks[j].state = z->backing != NULL ? BLOCK_SPILLED : BLOCK_ZERO;
+      list_init (&z->lru);
+      z->cached = BLOCK_NONE;
+      z->cache_dirty = false;
+
+      snprintf (name, sizeof name, "zr%d:%d", z->chan_no, z->dev_no);
+      disk_register (z->chan_no, z->dev_no, name, capacity, &zram_ops, z);
+      printf ("%s: %"PRDSNu" sectors, pool of up to %zu pages%s\n",
+              name, capacity, z->pool_limit,
+              z->backing != NULL ? ", spilling to ATA disk" : "");
+    }
+}
+
+static void flush_cache (struct zram *);
+static void spill_block (struct zram *, struct block *);
+
+/* Writes every RAM disk block back to the ATA disk it replaced,
+   if any, so that its contents survive power off. */
+void
+zram_done (void) 
+{
+  size_t i;
+
+  for (i = 0; i < device_cnt; i++) 
+    {
+      struct zram *z = &devices[i];
+
+      if (z->backing == NULL)
+        continue;
+      lock_acquire (&z->lock);
+      flush_cache (z);
+      while (!list_empty (&z->lru))
+        spill_block (z, list_entry (list_front (&z->lru),
+                                    struct block, lru_elem));
+      lock_release (&z->lock);
+    }
+}
+
+/* Prints RAM disk statistics. */
+void
+zram_print_stats (void) 
+{
+  size_t i;
+
+  for (i = 0; i < device_cnt; i++) 
+    {
+      struct zram *z = &devices[i];
+      long long ratio = z->out_bytes > 0 ? z->in_bytes * 100 / z->out_bytes : 0;
+
+      printf ("zr%d:%d: compression ratio %lld.%02lld, "
+              "%lld of %lld block loads hit the pool, %lld blocks spilled\n",
+              z->chan_no, z->dev_no, ratio / 100, ratio % 100,
+              z->hit_cnt, z->load_cnt, z->spill_cnt);
+    }
+}
+
+/* Pool management. */
+
+/* Returns the address of pool unit UNIT of Z. */
+static uint8_t *
+unit_addr (struct zram *z, size_t unit) 
+{
+  return z->pool[unit / PAGE_UNITS] + unit % PAGE_UNITS * UNIT_SIZE;
+}
+
+/* Tries to allocate CNT consecutive pool units within one pool
+   page of Z, adding a pool page if necessary.
+   Returns the first unit, or BITMAP_ERROR if the pool is full. */
+static size_t
+alloc_units (struct zram *z, size_t cnt) 
+{
+  size_t unit = 0;
+
+  ASSERT (cnt > 0 && cnt <= PAGE_UNITS);
+  for (;;)
+    {
+      size_t page;
+
+      unit = bitmap_scan (z->units, unit, cnt, false);
+      if (unit == BITMAP_ERROR)
+        return BITMAP_ERROR;
+
+      page = unit / PAGE_UNITS;
+      if ((unit + cnt - 1) / PAGE_UNITS != page)
+        {
+          /* Straddles two pool pages.  Try the next one. */
+          unit = (page + 1) * PAGE_UNITS;
+          continue;
+        }
+      if (z->pool[page] == NULL)
+        {
+          z->pool[page] = palloc_get_page (0);
+          if (z->pool[page] == NULL)
+            {
+              /* Out of kernel memory: the pool cannot grow beyond
+                 the pages it already has. */
+              bitmap_set_multiple (z->units, page * PAGE_UNITS,
+                                   (z->pool_limit - page) * PAGE_UNITS,
+                                   true);
+              continue;
+            }
+        }
+      bitmap_set_multiple (z->units, unit, cnt, true);
+      return unit;
+    }
+}
+
+/* Releases the pool units of block B of Z, which must be in the
+   pool. */
+static void
+free_units (struct zram *z, struct block *b) 
+{
+  ASSERT (b->state == BLOCK_POOL);
+  bitmap_set_multiple (z->units, b->unit, DIV_ROUND_UP (b->size, UNIT_SIZE),
+                       false);
+  list_remove (&b->lru_elem);
+}
+
+/* Returns the number of block B of Z. */
+static size_t
+block_no (struct zram *z, struct block *b) 
+{
+  return b - z->blocks;
+}
+
+/* Writes pooled block B of Z to the backing disk and frees its
+   pool units. */
+static void
+spill_block (struct zram *z, struct block *b) 
+{
+  disk_sector_t sector = block_no (z, b) * BLOCK_SECTORS;
+  const uint8_t *data;
+  size_t cnt, i;
+
+  ASSERT (z->backing != NULL);
+
+  if (b->size == BLOCK_SIZE)
+    data = unit_addr (z, b->unit);
+  else
+    {
+      lz_decompress (unit_addr (z, b->unit), z->spill);
+      data = z->spill;
+    }
+  /* The last block may extend past the end of the backing disk,
+     as in load_cache(). */
+  cnt = disk_size (z->backing) - sector;
+  if (cnt > BLOCK_SECTORS)
+    cnt = BLOCK_SECTORS;
+  for (i = 0; i < cnt; i++)
+    disk_write (z->backing, sector + i, data + i * DISK_SECTOR_SIZE);
+
+  free_units (z, b);
+  b->state = BLOCK_SPILLED;
+  z->spill_cnt++;
+}
+
+/* Stores the BLOCK_SIZE bytes at DATA as block B of Z. */
+static void
+store_block (struct zram *z, struct block *b, const uint8_t *data) 
+{
+  const uint8_t *src;
+  size_t size, i;
+
+  if (b->state == BLOCK_POOL)
+    free_units (z, b);
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    if (data[i] != 0)
+      break;
+  if (i == BLOCK_SIZE)
+    {
+      b->state = BLOCK_ZERO;
+      return;
+    }
+
+  size = lz_compress (data, z->out, z->table);
+  if (size != 0)
+    src = z->out;
+  else
+    {
+      /* Incompressible: store it as is. */
+      src = data;
+      size = BLOCK_SIZE;
+    }
+  z->in_bytes += BLOCK_SIZE;
+  z->out_bytes += size;
+
+  for (;;)
+    {
+      b->unit = alloc_units (z, DIV_ROUND_UP (size, UNIT_SIZE));
+      if (b->unit != BITMAP_ERROR)
+        break;
+      if (z->backing == NULL || list_empty (&z->lru))
+        PANIC ("zr%d:%d: pool full", z->chan_no, z->dev_no);
+      spill_block (z, list_entry (list_front (&z->lru),
+                                  struct block, lru_elem));
+    }
+
+  memcpy (unit_addr (z, b->unit), src, size);
+  b->size = size;
+  b->state = BLOCK_POOL;
+  list_push_back (&z->lru, &b->lru_elem);
+}
+
+/* Block cache. */
+
+/* Stores the cached block of Z if it has been modified. */
+static void
+flush_cache (struct zram *z) 
+{
+  if (z->cached != BLOCK_NONE && z->cache_dirty)
+    store_block (z, &z->blocks[z->cached], z->cache);
+  z->cache_dirty = false;
+}
+
+/* Makes block BLOCK the cached block of Z. */
+static void
+load_cache (struct zram *z, size_t block) 
+{
+  struct block *b = &z->blocks[block];
+
+  if (z->cached == block)
+    return;
+  flush_cache (z);
+
+  z->load_cnt++;
+  switch (b->state)
+    {
+    case BLOCK_ZERO:
+      memset (z->cache, 0, BLOCK_SIZE);
+      z->hit_cnt++;
+      break;
+
+    case BLOCK_POOL:
+      if (b->size == BLOCK_SIZE)
+        memcpy (z->cache, unit_addr (z, b->unit), BLOCK_SIZE);
+      else
+        lz_decompress (unit_addr (z, b->unit), z->cache);
+      list_remove (&b->lru_elem);
+      list_push_back (&z->lru, &b->lru_elem);
+      z->hit_cnt++;
+      break;
+
+    case BLOCK_SPILLED:
+      {
+        disk_sector_t sector = block * BLOCK_SECTORS;
+        size_t cnt = disk_size (z->backing) - sector;
+
+        if (cnt > BLOCK_SECTORS)
+          cnt = BLOCK_SECTORS;
+        disk_read_multiple (z->backing, sector, cnt, z->cache);
+        memset (z->cache + cnt * DISK_SECTOR_SIZE, 0,
+                (BLOCK_SECTORS - cnt) * DISK_SECTOR_SIZE);
+      }
+      break;
+    }
+  z->cached = block;
+}
+
+/* Reads SECTOR of RAM disk Z_ into BUFFER. */
+static void
+zram_read (void *z_, disk_sector_t sector, void *buffer) 
+{
+  struct zram *z = z_;
+
+  lock_acquire (&z->lock);
+  load_cache (z, sector / BLOCK_SECTORS);
+  memcpy (buffer, z->cache + sector % BLOCK_SECTORS * DISK_SECTOR_SIZE,
+          DISK_SECTOR_SIZE);
+  lock_release (&z->lock);
+}
+
+/* Writes BUFFER to SECTOR of RAM disk Z_. */
+static void
+zram_write (void *z_, disk_sector_t sector, const void *buffer) 
+{
+  struct zram *z = z_;
+
+  lock_acquire (&z->lock);
+  load_cache (z, sector / BLOCK_SECTORS);
+  memcpy (z->cache + sector % BLOCK_SECTORS * DISK_SECTOR_SIZE, buffer,
+          DISK_SECTOR_SIZE);
+  z->cache_dirty = true;
+  lock_release (&z->lock);
+}
+
+/* LZ77 codec, in the style of LZRW1.
+
+   The compressed form of a block is a sequence of groups, each
+   a 16-bit little-endian control word followed by up to 16
+   items, one per bit of the control word from the least
+   significant up.  A 0 bit means the item is a literal byte; a 1
+   bit means it is a 2-byte copy of 3 to 18 bytes from 1 to 4095
+   bytes back in the output, with the distance in the first 12
+   bits and the length minus 3 in the last 4. */
+
+#define LZ_HASH_BITS 11
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH 18
+#define LZ_MAX_OFFSET 4095
+
+/* Returns a hash of the 3 bytes at P. */
+static inline unsigned
+lz_hash (const uint8_t *p) 
+{
+  unsigned x = (p[0] << 16) | (p[1] << 8) | p[2];
+  return ((x * 2654435761u) >> (32 - LZ_HASH_BITS)) & ((1 << LZ_HASH_BITS) - 1);
+}
+
+/* Compresses the BLOCK_SIZE bytes at SRC into DST, which must have
+   room for BLOCK_SIZE bytes, using TABLE, a page of scratch
+   memory.  Returns the compressed size, or 0 if the block does
+   not compress to less than BLOCK_SIZE bytes. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, uint16_t *table) 
+{
+  const uint8_t *p = src, *end = src + BLOCK_SIZE;
+  uint8_t *out = dst, *ctrl_ptr = NULL;
+  unsigned ctrl = 0, bit = 16;
+
+  memset (table, 0, sizeof *table << LZ_HASH_BITS);
+  while (p < end) 
+    {
+      /* Leave room for a control word and a copy item. */
+      if (out + 4 > dst + BLOCK_SIZE)
+        return 0;
+      if (bit == 16) 
+        {
+          if (ctrl_ptr != NULL)
+            {
+              ctrl_ptr[0] = ctrl;
+              ctrl_ptr[1] = ctrl >> 8;
+            }
+          ctrl_ptr = out;
+          out += 2;
+          ctrl = bit = 0;
+        }
+
+      if (end - p >= LZ_MIN_MATCH)
+        {
+          unsigned h = lz_hash (p);
+          const uint8_t *q = src + table[h];
+          size_t offset = p - q;
+
+          table[h] = p - src;
+          if (offset > 0 && offset <= LZ_MAX_OFFSET
+              && q[0] == p[0] && q[1] == p[1] && q[2] == p[2])
+            {
+              size_t len = LZ_MIN_MATCH;
+              while (len < LZ_MAX_MATCH && p + len < end && q[len] == p[len])
+                len++;
+
+              *out++ = offset >> 4;
+              *out++ = ((offset & 0xf) << 4) | (len - LZ_MIN_MATCH);
+              ctrl |= 1u << bit++;
+              p += len;
+              continue;
+            }
+        }
+
+      *out++ = *p++;
+      bit++;
+    }
+  ctrl_ptr[0] = ctrl;
+  ctrl_ptr[1] = ctrl >> 8;
+
+  return out < dst + BLOCK_SIZE ? (size_t) (out - dst) : 0;
+}
+
+/* Decompresses the block compressed by lz_compress() at SRC into
+   the BLOCK_SIZE bytes at DST. */
+static void
+lz_decompress (const uint8_t *src, uint8_t *dst) 
+{
+  uint8_t *out = dst, *end = dst + BLOCK_SIZE;
+
+  while (out < end) 
+    {
+      unsigned ctrl = src[0] | (src[1] << 8);
+      unsigned bit;
+
+      src += 2;
+      for (bit = 0; bit < 16 && out < end; bit++)
+        if (ctrl & (1u << bit))
+          {
+            size_t offset = (src[0] << 4) | (src[1] >> 4);
+            size_t len = (src[1] & 0xf) + LZ_MIN_MATCH;
+            const uint8_t *q = out - offset;
+
+            src += 2;
+            ASSERT (q >= dst && out + len <= end);
+            while (len-- > 0)
+              *out++ = *q++;
+          }
+        else
+          *out++ = *src++;
+    }
+}
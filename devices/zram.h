@@ -0,0 +1,12 @@
+#ifndef DEVICES_ZRAM_H
+#define DEVICES_ZRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void zram_configure (int chan_no, int dev_no, size_t pool_pages);
+void zram_init (void);
+void zram_done (void);
+void zram_print_stats (void);
+
+#endif /* devices/zram.h */
@@ -0,0 +1,115 @@
+/* cksum.c
+
+   Prints the CRC-32 of FILE and the number of CPU cycles it took
+   to compute.
+
+     cksum FILE
+     cksum -a FILE
+
+   Without -a, reads FILE a block at a time with read() and
+   checksums each block after it arrives.  With -a, keeps up to
+   DEPTH reads in flight with aio_read(), so that the disk works
+   on later blocks while the CPU checksums earlier ones. */
+
+#include <rdtsc.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define BLOCK_SIZE (16 * 1024)
+#define DEPTH 4
+
+static char buf[DEPTH][BLOCK_SIZE];
+
+/* Adds the SIZE bytes in BLOCK to CRC, a bit at a time, which is
+   slow enough to compete with the disk. */
+static unsigned
+crc32 (unsigned crc, const char *block, int size) 
+{
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    {
+      crc ^= (unsigned char) block[i];
+      for (j = 0; j < 8; j++)
+        crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  return crc;
+}
+
+/* Checksums the file open as FD with read(). */
+static unsigned
+sum_sync (int fd) 
+{
+  unsigned crc = 0xffffffff;
+  int n;
+
+  while ((n = read (fd, buf[0], BLOCK_SIZE)) > 0)
+    crc = crc32 (crc, buf[0], n);
+  return ~crc;
+}
+
+/* Checksums the file open as FD, of SIZE bytes, with aio_read(),
+   keeping up to DEPTH blocks in flight. */
+static unsigned
+sum_async (int fd, int size) 
+{
+  int block_cnt = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  int ids[DEPTH];
+  unsigned crc = 0xffffffff;
+  int next, i;
+
+  /* Start the first DEPTH reads. */
+  for (next = 0; next < block_cnt && next < DEPTH; next++)
+    ids[next] = aio_read (fd, buf[next], BLOCK_SIZE, next * BLOCK_SIZE);
+
+  /* Checksum each block as it completes, then reuse its buffer
+     for the next block not yet started. */
+  for (i = 0; i < block_cnt; i++)
+    {
+      int slot = i % DEPTH;
+      int n = aio_wait (ids[slot]);
+      if (n < 0)
+        {
+          printf ("cksum: read of block %d failed\n", i);
+          break;
+        }
+      crc = crc32 (crc, buf[slot], n);
+      if (next < block_cnt)
+        {
+          ids[slot] = aio_read (fd, buf[slot], BLOCK_SIZE,
+                                next * BLOCK_SIZE);
+          next++;
+        }
+    }
+  return ~crc;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  bool async = argc == 3 && !strcmp (argv[1], "-a");
+  const char *file_name = argv[argc - 1];
+  unsigned long long start;
+  unsigned crc;
+  int fd;
+
+  if (argc != 2 && !async)
+    {
+      printf ("usage: cksum [-a] FILE\n");
+      return EXIT_FAILURE;
+    }
+  fd = open (file_name);
+  if (fd < 0)
+    {
+      printf ("%s: open failed\n", file_name);
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  crc = async ? sum_async (fd, filesize (fd)) : sum_sync (fd);
+  printf ("%08x %d %s (%llu cycles)\n",
+          crc, filesize (fd), file_name, rdtsc () - start);
+  close (fd);
+  return EXIT_SUCCESS;
+}
@@ -1,43 +1,63 @@
-/* cat.c
+/* cp.c
 
-Copies one file to another. */
+Copies one file to another.
+
+     cp OLD NEW
+     cp -u OLD NEW
+
+Copies inside the kernel with copy_file_range(), or with -u,
+through a user buffer with read() and write(). */
 
 #include <stdio.h>
+#include <string.h>
 #include <syscall.h>
 
 int
 main (int argc, char *argv[]) 
 {
-  int in_fd, out_fd;
+  bool user_copy = argc == 4 && !strcmp (argv[1], "-u");
+  const char *old_name = argv[argc - 2];
+  const char *new_name = argv[argc - 1];
+  int in_fd, out_fd, size;
 
-  if (argc != 3) 
+  if (argc != 3 && !user_copy) 
     {
-      printf ("usage: cp OLD NEW\n");
+      printf ("usage: cp [-u] OLD NEW\n");
       return EXIT_FAILURE;
     }
 
   /* Open input file. */
-  in_fd = open (argv[1]);
+  in_fd = open (old_name);
   if (in_fd < 0) 
     {
-      printf ("%s: open failed\n", argv[1]);
+      printf ("%s: open failed\n", old_name);
       return EXIT_FAILURE;
     }
 
   /* Create and open output file. */
-  if (!create (argv[2], filesize (in_fd))) 
+  size = filesize (in_fd);
+  if (!create (new_name, size)) 
     {
-      printf ("%s: create failed\n", argv[2]);
+      printf ("%s: create failed\n", new_name);
       return EXIT_FAILURE;
     }
-  out_fd = open (argv[2]);
+  out_fd = open (new_name);
   if (out_fd < 0) 
     {
-      printf ("%s: open failed\n", argv[2]);
+      printf ("%s: open failed\n", new_name);
       return EXIT_FAILURE;
     }
 
   /* Copy data. */
+  if (!user_copy)
+    {
+      if (copy_file_range (in_fd, out_fd, size) != size) 
+        {
+          printf ("%s: copy failed\n", new_name);
+          return EXIT_FAILURE;
+        }
+      return EXIT_SUCCESS;
+    }
   for (;;) 
     {
       char buffer[1024];
@@ -46,7 +66,7 @@ main (int argc, char *argv[])
         break;
       if (write (out_fd, buffer, bytes_read) != bytes_read) 
         {
-          printf ("%s: write failed\n", argv[2]);
+          printf ("%s: write failed\n", new_name);
           return EXIT_FAILURE;
         }
     }
@@ -0,0 +1,55 @@
+/* execbench.c
+
+   Runs PROGRAM COUNT times, one exec() after another, waiting
+   for each.  When run without arguments, does nothing and exits,
+   so that it can serve as its own child.
+
+     execbench 50 dummy
+     execbench 50 execbench
+
+   The first form loads a small program; the second loads this
+   one, which carries BALLAST_SIZE bytes of initialized data and
+   so has a large executable.  Compare the "Timer" line and the
+   reads on the file system disk that Pintos prints at power off
+   to see how exec latency grows with executable size, and the
+   "Image cache" and "Exec" lines to see how much of it the
+   kernel's executable image cache saves on repeated loads. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+#define BALLAST_SIZE (1024 * 1024)
+
+/* Initialized, so that it is stored in the executable, and
+   global, so that the compiler keeps all of it. */
+char ballast[BALLAST_SIZE] = { 1 };
+
+int
+main (int argc, char *argv[]) 
+{
+  int count, i;
+
+  if (argc == 1)
+    return ballast[0] == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+  if (argc != 3)
+    {
+      printf ("usage: execbench COUNT PROGRAM\n");
+      return EXIT_FAILURE;
+    }
+  count = atoi (argv[1]);
+
+  for (i = 0; i < count; i++)
+    {
+      pid_t pid = exec (argv[2]);
+      if (pid == PID_ERROR)
+        {
+          printf ("execbench: exec of %s %d failed\n", argv[2], i);
+          return EXIT_FAILURE;
+        }
+      wait (pid);
+    }
+
+  printf ("execbench: %s run %d times\n", argv[2], count);
+  return EXIT_SUCCESS;
+}
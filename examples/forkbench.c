@@ -0,0 +1,66 @@
+/* forkbench.c
+
+   Creates COUNT short-lived child processes one after another,
+   either with fork() or by exec()ing this program again, and
+   waits for each.  The parent first touches BUSY_SIZE bytes of
+   data, standing in for a warmed-up server process.
+
+     forkbench fork 100
+     forkbench exec 100
+
+   Compare the "Timer" and "Frame" lines that Pintos prints at
+   power off: a forked child shares the parent's pages until it
+   writes to them, while an exec()ed child loads its own copy of
+   the program. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define BUSY_SIZE (256 * 1024)
+
+static char busy[BUSY_SIZE];
+
+int
+main (int argc, char *argv[]) 
+{
+  bool use_fork;
+  int count, i;
+
+  if (argc == 2 && !strcmp (argv[1], "child"))
+    return EXIT_SUCCESS;
+  if (argc != 3 || (strcmp (argv[1], "fork") && strcmp (argv[1], "exec")))
+    {
+      printf ("usage: forkbench fork|exec COUNT\n");
+      return EXIT_FAILURE;
+    }
+  use_fork = !strcmp (argv[1], "fork");
+  count = atoi (argv[2]);
+
+  memset (busy, 1, sizeof busy);
+
+  for (i = 0; i < count; i++)
+    {
+      pid_t pid;
+
+      if (use_fork)
+        {
+          pid = fork ();
+          if (pid == 0)
+            exit (EXIT_SUCCESS);
+        }
+      else
+        pid = exec ("forkbench child");
+
+      if (pid == PID_ERROR)
+        {
+          printf ("forkbench: child %d could not be created\n", i);
+          return EXIT_FAILURE;
+        }
+      wait (pid);
+    }
+
+  printf ("forkbench: %d children created with %s\n", count, argv[1]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* logbench.c
+
+   Appends COUNT log records, each a 16-byte header, a 64-byte
+   payload, and an 8-byte trailer, to a file, either with three
+   write() calls per record or with one writev(), and prints the
+   average number of CPU cycles per record.
+
+     logbench 1000 write
+     logbench 1000 writev
+
+   The file system must have room for COUNT * 88 bytes. */
+
+#include <rdtsc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define HEADER_SIZE 16
+#define PAYLOAD_SIZE 64
+#define TRAILER_SIZE 8
+#define RECORD_SIZE (HEADER_SIZE + PAYLOAD_SIZE + TRAILER_SIZE)
+
+int
+main (int argc, char *argv[]) 
+{
+  const char *file_name = "logbench.dat";
+  char header[HEADER_SIZE], payload[PAYLOAD_SIZE], trailer[TRAILER_SIZE];
+  unsigned long long start;
+  bool vectored;
+  int count, fd, i;
+
+  if (argc != 3 || (count = atoi (argv[1])) <= 0
+      || (strcmp (argv[2], "write") && strcmp (argv[2], "writev")))
+    {
+      printf ("usage: logbench COUNT write|writev\n");
+      return EXIT_FAILURE;
+    }
+  vectored = !strcmp (argv[2], "writev");
+
+  remove (file_name);
+  if (!create (file_name, count * RECORD_SIZE))
+    {
+      printf ("logbench: create failed\n");
+      return EXIT_FAILURE;
+    }
+  fd = open (file_name);
+  if (fd < 0)
+    {
+      printf ("logbench: open failed\n");
+      return EXIT_FAILURE;
+    }
+
+  memset (payload, 'p', sizeof payload);
+  memset (trailer, '\n', sizeof trailer);
+  start = rdtsc ();
+  for (i = 0; i < count; i++)
+    {
+      snprintf (header, sizeof header, "%015d", i);
+      if (vectored)
+        {
+          struct iovec iov[3];
+          iov[0].iov_base = header;
+          iov[0].iov_len = sizeof header;
+          iov[1].iov_base = payload;
+          iov[1].iov_len = sizeof payload;
+          iov[2].iov_base = trailer;
+          iov[2].iov_len = sizeof trailer;
+          if (writev (fd, iov, 3) != RECORD_SIZE)
+            break;
+        }
+      else if (write (fd, header, sizeof header) != sizeof header
+               || write (fd, payload, sizeof payload) != sizeof payload
+               || write (fd, trailer, sizeof trailer) != sizeof trailer)
+        break;
+    }
+  if (i < count)
+    {
+      printf ("logbench: %s failed at record %d\n", argv[2], i);
+      return EXIT_FAILURE;
+    }
+
+  printf ("logbench: %d records with %s: %llu cycles per record\n",
+          count, argv[2], (rdtsc () - start) / count);
+  close (fd);
+  remove (file_name);
+  return EXIT_SUCCESS;
+}
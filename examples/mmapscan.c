@@ -0,0 +1,97 @@
+/* mmapscan.c
+
+   Scans a file once sequentially and once in random page order,
+   either through mmap or through read() into a buffer, and
+   prints a checksum of the data.  Run it on a multi-megabyte
+   file with both methods and compare the "Timer: N ticks" line
+   that Pintos prints at power off, e.g.
+
+     mmapscan big.dat mmap
+     mmapscan big.dat read */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define PAGE_SIZE 4096
+
+static unsigned char buffer[PAGE_SIZE];
+
+/* Returns a checksum of the SIZE bytes at DATA. */
+static unsigned
+sum_bytes (const unsigned char *data, int size)
+{
+  unsigned sum = 0;
+  int i;
+
+  for (i = 0; i < size; i++)
+    sum = sum * 31 + data[i];
+  return sum;
+}
+
+/* Returns the size of page PAGE of a file SIZE bytes long. */
+static int
+page_bytes (int page, int size)
+{
+  int left = size - page * PAGE_SIZE;
+  return left < PAGE_SIZE ? left : PAGE_SIZE;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  void *data = (void *) 0x10000000;
+  unsigned seq_sum = 0, rand_sum = 0;
+  int fd, size, page_cnt, i;
+  bool use_mmap;
+
+  if (argc != 3 || (strcmp (argv[2], "mmap") && strcmp (argv[2], "read")))
+    {
+      printf ("usage: mmapscan FILE mmap|read\n");
+      return EXIT_FAILURE;
+    }
+  use_mmap = !strcmp (argv[2], "mmap");
+
+  fd = open (argv[1]);
+  if (fd < 0) 
+    {
+      printf ("%s: open failed\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  size = filesize (fd);
+  page_cnt = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+  if (use_mmap && mmap (fd, data) == MAP_FAILED)
+    {
+      printf ("%s: mmap failed\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+
+  /* Sequential scan. */
+  for (i = 0; i < page_cnt; i++)
+    if (use_mmap)
+      seq_sum += sum_bytes ((unsigned char *) data + i * PAGE_SIZE,
+                            page_bytes (i, size));
+    else
+      seq_sum += sum_bytes (buffer, read (fd, buffer, PAGE_SIZE));
+
+  /* Random scan, one page at a time. */
+  random_init (0);
+  for (i = 0; i < page_cnt; i++)
+    {
+      int page = random_ulong () % page_cnt;
+      if (use_mmap)
+        rand_sum += sum_bytes ((unsigned char *) data + page * PAGE_SIZE,
+                               page_bytes (page, size));
+      else
+        {
+          seek (fd, page * PAGE_SIZE);
+          rand_sum += sum_bytes (buffer, read (fd, buffer, PAGE_SIZE));
+        }
+    }
+
+  printf ("%s: %d pages via %s, sequential sum %x, random sum %x\n",
+          argv[1], page_cnt, argv[2], seq_sum, rand_sum);
+  return EXIT_SUCCESS;
+}
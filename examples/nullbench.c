@@ -0,0 +1,55 @@
+/* nullbench.c
+
+   Makes COUNT system calls that do no work, first through
+   "int $0x30" and then through SYSENTER, and prints the average
+   number of CPU cycles each one took.
+
+     nullbench 100000
+
+   The cycle counts are only meaningful relative to each other,
+   and only under an emulator or machine with a steady time stamp
+   counter. */
+
+#include <rdtsc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+/* Makes COUNT calls to tell() on a bad file descriptor and
+   returns the average number of cycles per call. */
+static unsigned
+null_calls (int count)
+{
+  unsigned long long start = rdtsc ();
+  int i;
+
+  for (i = 0; i < count; i++)
+    tell (-1);
+  return (rdtsc () - start) / count;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int count;
+  unsigned slow, fast;
+
+  if (argc != 2 || (count = atoi (argv[1])) <= 0)
+    {
+      printf ("usage: nullbench COUNT\n");
+      return EXIT_FAILURE;
+    }
+
+  fast_syscalls (false);
+  slow = null_calls (count);
+  printf ("nullbench: int $0x30: %u cycles per call\n", slow);
+
+  if (!fast_syscalls (true))
+    {
+      printf ("nullbench: SYSENTER not supported\n");
+      return EXIT_SUCCESS;
+    }
+  fast = null_calls (count);
+  printf ("nullbench: sysenter:  %u cycles per call\n", fast);
+  return EXIT_SUCCESS;
+}
@@ -1,13 +1,28 @@
+#include <rdtsc.h>
+#include <stdio.h>
+#include <string.h>
 #include "syscall.h"
+#include "pfs.h"
 
 int main(void)
 {
   int i;
   int pid[5];
+  struct pfs_shared *shared;
+  unsigned long long start;
   
-  create("file.1", 50000);
-  create("messages", 5000);
-  
+  /* The writers and readers share the buffer through a shared
+     memory segment instead of a file, and take turns with a lock
+     in the segment. */
+  shared = shm_create(PFS_KEY, sizeof *shared);
+  if (shared == NULL)
+  {
+    printf("pfs: shm_create() failed\n");
+    exit(1);
+  }
+  memset(shared->buffer, 'a', BIG);
+
+  start = rdtsc();
   pid[0] = exec("pfs_writer a z");
   pid[1] = exec("pfs_writer A Z");
   pid[2] = exec("pfs_reader");
@@ -18,5 +33,10 @@ int main(void)
   {
     wait(pid[i]);
   }
+
+  printf("pfs: %d buffers of %d bytes read, %d inconsistent, "
+         "in %llu cycles\n", shared->reads, BIG, shared->inconsistent,
+         rdtsc() - start);
+  shm_detach(shared);
   exit(0);
 }
@@ -1,2 +1,63 @@
 #define BIG 3000
 #define TIMES 500
+
+/* Key of the shared memory segment that pfs creates. */
+#define PFS_KEY 0x706673
+
+/* Shared by pfs, the writers and the readers. */
+struct pfs_shared
+  {
+    int lock;                   /* See pfs_lock(). */
+    int reads;                  /* Buffers read. */
+    int inconsistent;           /* Buffers read that were mixed. */
+    char buffer[BIG];           /* Filled with one character at a time. */
+  };
+
+/* Atomically stores NEW in *P if it holds OLD, and returns the
+   old value of *P. */
+static inline int
+pfs_cmpxchg (int *p, int old, int new)
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p) : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically stores NEW in *P and returns the old value. */
+static inline int
+pfs_xchg (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Acquires the lock at *LOCK, which is 0 if the lock is free, 1
+   if it is held, and 2 if it is held and someone may be sleeping
+   in futex_wait() for it.  Uncontended, it never enters the
+   kernel. */
+static inline void
+pfs_lock (int *lock)
+{
+  int c = pfs_cmpxchg (lock, 0, 1);
+  if (c != 0)
+    {
+      if (c != 2)
+        c = pfs_xchg (lock, 2);
+      while (c != 0)
+        {
+          futex_wait (lock, 2);
+          c = pfs_xchg (lock, 2);
+        }
+    }
+}
+
+/* Releases the lock at *LOCK, waking a sleeper if there may be
+   one. */
+static inline void
+pfs_unlock (int *lock)
+{
+  if (pfs_xchg (lock, 0) == 2)
+    futex_wake (lock, 1);
+}
@@ -1,48 +1,49 @@
-/* Reads from the file and checks consistency.
+/* Reads from the shared buffer and checks consistency.
  * The buffer should all contain the same character!!
  */
 
 #include <syscall.h>
 #include <stdio.h>
+#include <string.h>
 #include "pfs.h"
 
 char buffer[BIG];
 
 int main(void)
 {
-  int bytes, i, j, inconsistency;
-  int id, messages;
+  struct pfs_shared *shared;
+  int i, j, inconsistency;
   
-  messages = open("messages");
+  shared = shm_attach(PFS_KEY);
+  if (shared == NULL)
+  {
+    printf("TEST ERROR: shm_attach() failed\n");
+    exit(1);
+  }
   
   for (i = 0; i < TIMES; ++i)
   {
-    id = open("file.1");
-    bytes = read(id, buffer, BIG);
-    close(id);
+    pfs_lock(&shared->lock);
+    memcpy(buffer, shared->buffer, BIG);
+    pfs_unlock(&shared->lock);
     
-    if (bytes != BIG)
-    {
-      write(messages, "Buffer not filled!\n", 19);
-      continue;
-    }
     /* now check for consistency */
     for (j = 1, inconsistency = 0; j < BIG; ++j)
     {
       if (buffer[0] != buffer[j])
       {
         /* Ooops, inconsistency */
-	write(messages, "INCONSISTENCY.", 14);
 	printf("INCONSISTENCY\n");
 	inconsistency = 1;
 	break; /* no need to check further */
       }
     }
-    if (!inconsistency)
-    {
-      write(messages, "cool\n", 5);
-    }
+
+    pfs_lock(&shared->lock);
+    shared->reads++;
+    shared->inconsistent += inconsistency;
+    pfs_unlock(&shared->lock);
   }
-  close(messages);
+  shm_detach(shared);
   exit(0);
 }
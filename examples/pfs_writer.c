@@ -1,4 +1,4 @@
-/* Write on the disk.
+/* Write into the shared buffer.
  * Each time the buffer is filled with same character.
  * Different character every time!
  */
@@ -8,14 +8,11 @@
 #include <string.h>
 #include "pfs.h"
 
-char buffer[BIG];
-
 int main(int argc, char* argv[])
 {
-  int i,j;
+  struct pfs_shared *shared;
+  int i;
   char c;
-  int id;
-  int write_count;
   char start;
   char end;
 
@@ -24,24 +21,23 @@ int main(int argc, char* argv[])
   
   start = argv[1][0];
   end   = argv[2][0];
+
+  shared = shm_attach(PFS_KEY);
+  if (shared == NULL)
+  {
+    printf("TEST ERROR: shm_attach() failed\n");
+    exit(1);
+  }
   
   for (i = 0; i < TIMES / (end - start + 1) + 1; ++i)
   {
     for (c = start; c <= end; ++c)
     {
-      for (j = 0; j < BIG; j++)
-        buffer[j] = c;
-      
-      id = open("file.1");
-      write_count = write(id, buffer, BIG);
-      
-      if ( write_count != BIG )
-      {
-        printf("TEST ERROR: write() wrote only %d bytes out of %d bytes\n",
-               write_count, BIG);
-      }
-      close(id);
+      pfs_lock(&shared->lock);
+      memset(shared->buffer, c, BIG);
+      pfs_unlock(&shared->lock);
     }
   }
+  shm_detach(shared);
   exit(0);
 }
@@ -0,0 +1,120 @@
+/* pipebench.c
+
+   Passes KB kilobytes (default 256) from this process to a child
+   process, first through a pipe and then through a temporary
+   file the way pfs_writer and pfs_reader do, and prints the
+   number of CPU cycles each took.
+
+     pipebench 1024
+
+   The child is this program run as "pipebench -p FD" or
+   "pipebench -f"; it reads until end of file and exits with the
+   number of kilobytes it received.  The cycle counts are only
+   meaningful relative to each other.  The file system must have
+   room for a KB-kilobyte file. */
+
+#include <rdtsc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define BUF_SIZE 4096
+
+static const char *file_name = "pipebench.dat";
+static char buf[BUF_SIZE];
+
+/* Reads FD to end of file and returns the number of kilobytes
+   read. */
+static int
+consume (int fd)
+{
+  int n, total = 0;
+
+  while ((n = read (fd, buf, sizeof buf)) > 0)
+    total += n;
+  return total / 1024;
+}
+
+/* Writes KB kilobytes to FD.  Returns true if successful. */
+static bool
+produce (int fd, int kb)
+{
+  int i;
+
+  memset (buf, 'x', sizeof buf);
+  for (i = 0; i < kb * 1024 / BUF_SIZE; i++)
+    if (write (fd, buf, BUF_SIZE) != BUF_SIZE)
+      return false;
+  return true;
+}
+
+/* Passes KB kilobytes to a child through a pipe.  Returns the
+   number of kilobytes the child received. */
+static int
+through_pipe (int kb)
+{
+  char cmd[32];
+  int fds[2], pid;
+
+  if (pipe (fds) < 0)
+    return -1;
+  snprintf (cmd, sizeof cmd, "pipebench -p %d", fds[0]);
+  pid = exec (cmd);
+  close (fds[0]);
+  if (pid < 0 || !produce (fds[1], kb))
+    {
+      close (fds[1]);
+      return -1;
+    }
+  close (fds[1]);
+  return wait (pid);
+}
+
+/* Passes KB kilobytes to a child through a temporary file.
+   Returns the number of kilobytes the child received. */
+static int
+through_file (int kb)
+{
+  int fd, received;
+  bool ok;
+
+  remove (file_name);
+  if (!create (file_name, kb * 1024) || (fd = open (file_name)) < 0)
+    return -1;
+  ok = produce (fd, kb);
+  close (fd);
+  received = ok ? wait (exec ("pipebench -f")) : -1;
+  remove (file_name);
+  return received;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  unsigned long long start;
+  int kb, received;
+
+  if (argc == 3 && !strcmp (argv[1], "-p"))
+    return consume (atoi (argv[2]));
+  else if (argc == 2 && !strcmp (argv[1], "-f"))
+    return consume (open (file_name));
+
+  kb = argc > 1 ? atoi (argv[1]) : 256;
+  if (kb <= 0 || kb * 1024 % BUF_SIZE != 0)
+    {
+      printf ("usage: pipebench [KB] (a multiple of %d)\n", BUF_SIZE / 1024);
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  received = through_pipe (kb);
+  printf ("pipebench: pipe: %d of %d kB in %llu cycles\n",
+          received, kb, rdtsc () - start);
+
+  start = rdtsc ();
+  received = through_file (kb);
+  printf ("pipebench: file: %d of %d kB in %llu cycles\n",
+          received, kb, rdtsc () - start);
+  return EXIT_SUCCESS;
+}
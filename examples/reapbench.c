@@ -0,0 +1,119 @@
+/* reapbench.c
+
+   Acts as a supervisor of COUNT (default 32) workers, which are
+   copies of this program that spin for a while and exit, the
+   ones started last spinning least, so that workers exit roughly
+   in the reverse of the order they were started in.  The workers
+   are reaped first with wait() in the order they were started,
+   then with waitpid(-1) in the order they exit, and for each the
+   number of CPU cycles until the first and the last worker was
+   reaped is printed.
+
+     reapbench 32
+
+   The cycle counts are only meaningful relative to each other. */
+
+#include <rdtsc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Loop iterations per unit of worker spinning. */
+#define SPIN_UNIT 20000
+
+/* Most workers. */
+#define MAX_WORKERS 128
+
+/* Spins for UNITS units, in a way the compiler cannot drop. */
+static void
+spin (int units)
+{
+  volatile int i;
+
+  for (i = 0; i < units * SPIN_UNIT; i++)
+    continue;
+}
+
+/* Starts COUNT workers and reaps them, with waitpid(-1) if ANY
+   is true, otherwise with wait() in the order they were started.
+   Stores the cycles until the first and the last was reaped into
+   *FIRST and *LAST.  Returns false if a worker failed. */
+static bool
+run (int count, bool any, unsigned long long *first,
+     unsigned long long *last)
+{
+  pid_t pids[MAX_WORKERS];
+  unsigned long long start = rdtsc ();
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      char units[16];
+      char *argv[] = { "reapbench", "-w", units, NULL };
+
+      snprintf (units, sizeof units, "%d", count - i);
+      pids[i] = spawn ("reapbench", argv, SPAWN_NOWAIT);
+      if (pids[i] == PID_ERROR)
+        {
+          printf ("reapbench: spawn of worker %d failed\n", i);
+          return false;
+        }
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      int status;
+
+      if (any)
+        {
+          if (waitpid (-1, &status, 0) == PID_ERROR)
+            return false;
+        }
+      else
+        status = wait (pids[i]);
+      if (status != 0)
+        {
+          printf ("reapbench: worker exited with %d\n", status);
+          return false;
+        }
+      if (i == 0)
+        *first = rdtsc () - start;
+    }
+  *last = rdtsc () - start;
+  return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned long long first, last;
+  int count;
+
+  if (argc == 3 && !strcmp (argv[1], "-w"))
+    {
+      spin (atoi (argv[2]));
+      return EXIT_SUCCESS;
+    }
+
+  count = argc > 1 ? atoi (argv[1]) : 32;
+  if (count <= 0 || count > MAX_WORKERS)
+    {
+      printf ("usage: reapbench [COUNT], with COUNT at most %d\n",
+              MAX_WORKERS);
+      return EXIT_FAILURE;
+    }
+
+  if (!run (count, false, &first, &last))
+    return EXIT_FAILURE;
+  printf ("reapbench: %d workers, wait in order: "
+          "first reaped after %llu, last after %llu cycles\n",
+          count, first, last);
+
+  if (!run (count, true, &first, &last))
+    return EXIT_FAILURE;
+  printf ("reapbench: %d workers, waitpid(-1): "
+          "first reaped after %llu, last after %llu cycles\n",
+          count, first, last);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/* ringbench.c
+
+   Creates a FILE_KB-kilobyte file, then makes COUNT reads of 4 kB
+   blocks at random block offsets in it, either with seek() and
+   read() for each block or by submitting BATCH pread operations
+   at a time through a submission ring, and prints the average
+   number of CPU cycles per block.
+
+     ringbench 1000 read
+     ringbench 1000 ring
+
+   The file system must have room for a FILE_KB-kilobyte file. */
+
+#include <random.h>
+#include <rdtsc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define BLOCK_SIZE 4096
+#define FILE_KB 256
+#define BLOCK_CNT (FILE_KB * 1024 / BLOCK_SIZE)
+#define BATCH 16
+
+static char buf[BATCH][BLOCK_SIZE];
+
+/* Returns the offset of a random block of the file. */
+static unsigned
+random_offset (void) 
+{
+  return random_ulong () % BLOCK_CNT * BLOCK_SIZE;
+}
+
+/* Reads COUNT random blocks from FD with seek() and read().
+   Returns true if successful. */
+static bool
+read_blocks (int fd, int count) 
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      seek (fd, random_offset ());
+      if (read (fd, buf[0], BLOCK_SIZE) != BLOCK_SIZE)
+        return false;
+    }
+  return true;
+}
+
+/* Reads COUNT random blocks from FD through RING, BATCH at a
+   time.  Returns true if successful. */
+static bool
+ring_blocks (struct ring *ring, int fd, int count) 
+{
+  int i;
+
+  for (i = 0; i < count; i += BATCH)
+    {
+      int batch = count - i < BATCH ? count - i : BATCH;
+      int j;
+
+      for (j = 0; j < batch; j++)
+        {
+          struct ring_sqe *sqe = &ring->sq[ring->sq_tail % RING_ENTRIES];
+          sqe->op = RING_OP_PREAD;
+          sqe->fd = fd;
+          sqe->buf = buf[j];
+          sqe->len = BLOCK_SIZE;
+          sqe->offset = random_offset ();
+          sqe->user_data = j;
+          ring->sq_tail++;
+        }
+      if (ring_enter (batch, batch) != batch)
+        return false;
+      for (; ring->cq_head != ring->cq_tail; ring->cq_head++)
+        if (ring->cq[ring->cq_head % RING_ENTRIES].result != BLOCK_SIZE)
+          return false;
+    }
+  return true;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  const char *file_name = "ringbench.dat";
+  unsigned long long start;
+  struct ring *ring = NULL;
+  int count, fd, i;
+  bool ok;
+
+  if (argc != 3 || (count = atoi (argv[1])) <= 0
+      || (strcmp (argv[2], "read") && strcmp (argv[2], "ring")))
+    {
+      printf ("usage: ringbench COUNT read|ring\n");
+      return EXIT_FAILURE;
+    }
+  if (!strcmp (argv[2], "ring") && (ring = ring_setup ()) == NULL)
+    {
+      printf ("ringbench: ring_setup failed\n");
+      return EXIT_FAILURE;
+    }
+
+  remove (file_name);
+  if (!create (file_name, FILE_KB * 1024) || (fd = open (file_name)) < 0)
+    {
+      printf ("ringbench: cannot create %s\n", file_name);
+      return EXIT_FAILURE;
+    }
+  memset (buf[0], 'r', BLOCK_SIZE);
+  for (i = 0; i < BLOCK_CNT; i++)
+    write (fd, buf[0], BLOCK_SIZE);
+
+  random_init (0);
+  start = rdtsc ();
+  ok = ring != NULL ? ring_blocks (ring, fd, count) : read_blocks (fd, count);
+  if (!ok)
+    {
+      printf ("ringbench: %s failed\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+  printf ("ringbench: %d blocks with %s: %llu cycles per block\n",
+          count, argv[2], (rdtsc () - start) / count);
+
+  close (fd);
+  remove (file_name);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/* spawnbench.c
+
+   Starts COUNT (default 1000) short-lived children running
+   "dummy", waiting for each, first with exec(), then with
+   spawn(), then with spawn(SPAWN_NOWAIT), and prints the average
+   number of CPU cycles per child for each.
+
+     spawnbench 1000
+
+   The cycle counts are only meaningful relative to each other. */
+
+#include <rdtsc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+/* Starts COUNT children and waits for each, with exec() if
+   FLAGS is -1, otherwise with spawn() and FLAGS.  Returns the
+   average cycles per child, or 0 if a child failed. */
+static unsigned
+run (int count, int flags)
+{
+  static char *const argv[] = { "dummy", "7", NULL };
+  unsigned long long start = rdtsc ();
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      pid_t pid = (flags < 0 ? exec ("dummy 7")
+                   : spawn ("dummy", argv, flags));
+      if (pid < 0 || wait (pid) != 7)
+        return 0;
+    }
+  return (rdtsc () - start) / count;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int count = argc > 1 ? atoi (argv[1]) : 1000;
+  unsigned exec_cycles, spawn_cycles, nowait_cycles;
+
+  if (count <= 0)
+    {
+      printf ("usage: spawnbench [COUNT]\n");
+      return EXIT_FAILURE;
+    }
+
+  exec_cycles = run (count, -1);
+  spawn_cycles = run (count, 0);
+  nowait_cycles = run (count, SPAWN_NOWAIT);
+  printf ("spawnbench: %d children: exec %u, spawn %u, "
+          "spawn nowait %u cycles each\n",
+          count, exec_cycles, spawn_cycles, nowait_cycles);
+  return EXIT_SUCCESS;
+}
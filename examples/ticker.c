@@ -0,0 +1,42 @@
+/* ticker.c
+
+   A small event loop: echoes keys typed at the console and
+   prints a tick every INTERVAL milliseconds (default 1000) while
+   none are typed, sleeping in poll() in between.  Type 'q' to
+   quit.
+
+     ticker 500 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+int
+main (int argc, char *argv[])
+{
+  int interval = argc > 1 ? atoi (argv[1]) : 1000;
+  struct pollfd pfd;
+  int ticks = 0;
+
+  pfd.fd = STDIN_FILENO;
+  pfd.events = POLLIN;
+  for (;;)
+    {
+      int n = poll (&pfd, 1, interval);
+      if (n < 0)
+        {
+          printf ("%s: poll failed\n", argv[0]);
+          return EXIT_FAILURE;
+        }
+      else if (n == 0)
+        printf ("tick %d\n", ++ticks);
+      else
+        {
+          char c;
+          if (read (STDIN_FILENO, &c, 1) != 1 || c == 'q')
+            break;
+          printf ("key '%c'\n", c);
+        }
+    }
+  return EXIT_SUCCESS;
+}
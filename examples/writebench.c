@@ -0,0 +1,72 @@
+/* writebench.c
+
+   Writes TOTAL_SIZE bytes to a file in write() calls of
+   BUF_KB kilobytes each, then reads them back the same way.
+   BUF_KB must be a power of two.
+
+     writebench 4
+     writebench 1024
+
+   Run it once for each buffer size and compare the "Timer" line
+   that Pintos prints at power off.  The file system must have
+   room for a TOTAL_SIZE-byte file. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define TOTAL_SIZE (1024 * 1024)
+
+static char buf[TOTAL_SIZE];
+
+int
+main (int argc, char *argv[]) 
+{
+  const char *file_name = "writebench.dat";
+  int buf_size, calls, done, fd;
+
+  if (argc != 2 || (buf_size = atoi (argv[1]) * 1024) <= 0
+      || buf_size > TOTAL_SIZE || TOTAL_SIZE % buf_size != 0)
+    {
+      printf ("usage: writebench BUF_KB (a power of 2, at most %d)\n",
+              TOTAL_SIZE / 1024);
+      return EXIT_FAILURE;
+    }
+
+  remove (file_name);
+  if (!create (file_name, TOTAL_SIZE))
+    {
+      printf ("writebench: create failed\n");
+      return EXIT_FAILURE;
+    }
+  fd = open (file_name);
+  if (fd < 0)
+    {
+      printf ("writebench: open failed\n");
+      return EXIT_FAILURE;
+    }
+
+  memset (buf, 'x', buf_size);
+  calls = 0;
+  for (done = 0; done < TOTAL_SIZE; done += buf_size, calls++)
+    if (write (fd, buf, buf_size) != buf_size)
+      {
+        printf ("writebench: write failed at byte %d\n", done);
+        return EXIT_FAILURE;
+      }
+
+  seek (fd, 0);
+  for (done = 0; done < TOTAL_SIZE; done += buf_size, calls++)
+    if (read (fd, buf, buf_size) != buf_size)
+      {
+        printf ("writebench: read failed at byte %d\n", done);
+        return EXIT_FAILURE;
+      }
+
+  close (fd);
+  remove (file_name);
+  printf ("writebench: %d kB written and read in %d calls of %d kB\n",
+          TOTAL_SIZE / 1024 * 2, calls, buf_size / 1024);
+  return EXIT_SUCCESS;
+}
@@ -1,7 +1,10 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 
 /* An open file. */
 struct file 
@@ -9,6 +12,9 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    int ref_cnt;                /* Number of openers sharing the file. */
+    struct pipe *pipe;          /* Pipe, if not null; INODE is null. */
+    bool pipe_writer;           /* Write end of PIPE? */
   };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -23,6 +29,7 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->ref_cnt = 1;
       return file;
     }
   else
@@ -33,21 +40,57 @@ file_open (struct inode *inode)
     }
 }
 
+/* Opens and returns a new file for the write end of PIPE, if
+   WRITER is true, or its read end otherwise, taking ownership of
+   that end.  Returns a null pointer, having closed that end of
+   PIPE, if an allocation fails. */
+struct file *
+file_open_pipe (struct pipe *pipe, bool writer) 
+{
+  struct file *file = calloc (1, sizeof *file);
+  if (file == NULL)
+    {
+      pipe_close (pipe, writer);
+      return NULL;
+    }
+  file->pipe = pipe;
+  file->pipe_writer = writer;
+  file->ref_cnt = 1;
+  return file;
+}
+
 /* Opens and returns a new file for the same inode as FILE.
-   Returns a null pointer if unsuccessful. */
+   Returns a null pointer if unsuccessful, or if FILE is a
+   pipe. */
 struct file *
 file_reopen (struct file *file) 
 {
+  if (file->pipe != NULL)
+    return NULL;
   return file_open (inode_reopen (file->inode));
 }
 
-/* Closes FILE. */
+/* Returns FILE itself, shared with a new opener, who will see
+   the same file position and must close it separately. */
+struct file *
+file_dup (struct file *file) 
+{
+  lock_acquire(&flock);
+  file->ref_cnt++;
+  lock_release(&flock);
+  return file;
+}
+
+/* Closes FILE.  A file shared through file_dup() is only freed
+   once every opener has closed it. */
 void
 file_close (struct file *file) 
 {
   lock_acquire(&flock);
-  if (file != NULL)
+  if (file != NULL && --file->ref_cnt == 0)
     {
+      if (file->pipe != NULL)
+        pipe_close (file->pipe, file->pipe_writer);
       file_allow_write (file);
       inode_close (file->inode);
       free (file); 
@@ -55,7 +98,31 @@ file_close (struct file *file)
   lock_release(&flock);
 }
 
-/* Returns the inode encapsulated by FILE. */
+/* Returns true if FILE is an end of a pipe. */
+bool
+file_is_pipe (struct file *file) 
+{
+  return file->pipe != NULL;
+}
+
+/* Returns true if reading from FILE, or writing to it if WRITE
+   is true, would not block.  If that may change, stores in *Q the
+   wait queue that is woken when it does, otherwise a null
+   pointer.  Only pipes ever block, and never at the wrong end. */
+bool
+file_poll (struct file *file, bool write, struct waitq **q) 
+{
+  *q = NULL;
+  if (file->pipe == NULL)
+    return true;
+  if (write != file->pipe_writer)
+    return false;
+  *q = pipe_waitq (file->pipe);
+  return pipe_ready (file->pipe, write);
+}
+
+/* Returns the inode encapsulated by FILE, or a null pointer if
+   FILE is a pipe. */
 struct inode *
 file_get_inode (struct file *file) 
 {
@@ -66,11 +133,18 @@ file_get_inode (struct file *file)
    starting at the file's current position.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+
+   If FILE is the read end of a pipe, waits for data and returns
+   what is available, 0 only at end of file; returns -1 if FILE
+   is the write end. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
   off_t bytes_read;
+
+  if (file->pipe != NULL)
+    return !file->pipe_writer ? pipe_read (file->pipe, buffer, size) : -1;
   
   sema_down(&mutex);
   readcount++;
@@ -92,12 +166,16 @@ file_read (struct file *file, void *buffer, off_t size)
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   The file's current position is unaffected. */
+   The file's current position is unaffected.
+   Returns -1 if FILE is a pipe. */
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) 
 {
   off_t bytes_read;
 
+  if (file->pipe != NULL)
+    return -1;
+
   sema_down(&mutex);
   readcount++;
   if (readcount == 1) sema_down(&wrt);
@@ -119,11 +197,18 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+
+   If FILE is the write end of a pipe, waits until all of BUFFER
+   is written or the read end is closed (see pipe_write());
+   returns -1 if FILE is the read end. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
   off_t bytes_written;
+
+  if (file->pipe != NULL)
+    return file->pipe_writer ? pipe_write (file->pipe, buffer, size) : -1;
   sema_down(&wrt);
   
   bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
@@ -139,21 +224,59 @@ file_write (struct file *file, const void *buffer, off_t size)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   The file's current position is unaffected. */
+   The file's current position is unaffected.
+   Returns -1 if FILE is a pipe. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs) 
 {
   off_t bytes_written;
+
+  if (file->pipe != NULL)
+    return -1;
   sema_down(&wrt);
   
   bytes_written = inode_write_at (file->inode, buffer, size, file_ofs);
-  file->pos += bytes_written;
   
   sema_up(&wrt);
   return bytes_written;
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, to DST, starting at its current position, a page at
+   a time through a kernel buffer.  Returns the number of bytes
+   copied, which may be less than SIZE if end of SRC or DST is
+   reached or memory is short.  Advances both positions by the
+   number of bytes copied. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size) 
+{
+  off_t bytes_copied = 0;
+  void *buffer;
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return 0;
+  while (size > 0)
+    {
+      off_t chunk_size = size < PGSIZE ? size : PGSIZE;
+      off_t bytes_read, bytes_written;
+
+      bytes_read = file_read (src, buffer, chunk_size);
+      bytes_written = bytes_read > 0 ? file_write (dst, buffer, bytes_read) : 0;
+      if (bytes_written < 0)
+        bytes_written = 0;
+      if (bytes_written < bytes_read)
+        file_seek (src, src->pos - (bytes_read - bytes_written));
+      bytes_copied += bytes_written;
+      size -= bytes_written;
+      if (bytes_written < chunk_size)
+        break;
+    }
+  palloc_free_page (buffer);
+  return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -181,11 +304,13 @@ file_allow_write (struct file *file)
     }
 }
 
-/* Returns the size of FILE in bytes. */
+/* Returns the size of FILE in bytes, or 0 if it is a pipe. */
 off_t
 file_length (struct file *file) 
 {
   ASSERT (file != NULL);
+  if (file->pipe != NULL)
+    return 0;
   return inode_length (file->inode);
 }
 
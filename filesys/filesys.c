@@ -4,6 +4,7 @@
 #include <string.h>
 #include "filesys/file.h"
 #include "filesys/free-map.h"
+#include "filesys/initrd.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
@@ -43,7 +44,8 @@ filesys_done (void)
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
-   Fails if a file named NAME already exists,
+   Fails if a file named NAME already exists, including one in
+   the initial RAM file system,
    or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) 
@@ -51,6 +53,7 @@ filesys_create (const char *name, off_t initial_size)
   disk_sector_t inode_sector = 0;
   struct dir *dir = dir_open_root ();
   bool success = (dir != NULL
+                  && !initrd_exists (name)
                   && free_map_allocate (1, &inode_sector)
                   && inode_create (inode_sector, initial_size)
                   && dir_add (dir, name, inode_sector));
@@ -65,14 +68,19 @@ filesys_create (const char *name, off_t initial_size)
    Returns the new file if successful or a null pointer
    otherwise.
    Fails if no file named NAME exists,
-   or if an internal memory allocation fails. */
+   or if an internal memory allocation fails.
+   A file in the initial RAM file system (see filesys/initrd.c)
+   takes precedence over one of the same name on disk. */
 struct file *
 filesys_open (const char *name)
 {
+  struct inode *inode = initrd_open (name);
+  if (inode != NULL)
+    return file_open (inode);
+
   lock_acquire(&file_lock);
   
   struct dir *dir = dir_open_root ();
-  struct inode *inode = NULL;
 
   if (dir != NULL)
     dir_lookup (dir, name, &inode);
@@ -84,13 +92,15 @@ filesys_open (const char *name)
 
 /* Deletes the file named NAME.
    Returns true if successful, false on failure.
-   Fails if no file named NAME exists,
+   Fails if no file named NAME exists, if NAME is in the
+   read-only initial RAM file system,
    or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) 
 {
   struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  bool success = (dir != NULL && !initrd_exists (name)
+                  && dir_remove (dir, name));
   dir_close (dir); 
 
   return success;
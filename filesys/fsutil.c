@@ -6,6 +6,7 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/initrd.h"
 #include "devices/disk.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
@@ -75,7 +76,9 @@ fsutil_rm (char **argv)
    the file content.
 
    The first call to this function will read starting at the
-   beginning of the scratch disk.  Later calls advance across the
+   beginning of the scratch disk, or just past the initial RAM
+   file system archive if one was loaded from it (see
+   filesys/initrd.c).  Later calls advance across the
    disk.  This disk position is independent of that used for
    fsutil_get(), so all `put's should precede all `get's. */
 void
@@ -90,6 +93,8 @@ fsutil_put (char **argv)
   void *buffer;
 
   printf ("Putting '%s' into the file system...\n", file_name);
+  if (sector == 0)
+    sector = initrd_size ();
 
   /* Allocate buffer. */
   buffer = malloc (DISK_SECTOR_SIZE);
@@ -0,0 +1,305 @@
+#include "filesys/initrd.h"
+#include <debug.h>
+#include <limits.h>
+#include <list.h>
+#include <round.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "devices/timer.h"
+#include "filesys/directory.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Initial RAM file system.
+
+   With the -initrd option, the kernel reads a "ustar" archive,
+   as written by `tar --format=ustar' or by the `pintos' script's
+   --initrd option, from the start of the scratch disk (hdc or
+   hd1:0) at boot.  Each regular file in the archive is kept in
+   kernel memory as a read-only inode (see inode_create_ram())
+   that filesys_open() finds before looking on the file system
+   disk, so that user programs can be run without first copying
+   them onto that disk with `put', and are then loaded from
+   memory.  The `pintos' script only archives executables; other
+   files follow the archive on the scratch disk, to be `put' on
+   the file system disk as usual (see fsutil_put()).
+
+   Archive files behave like read-only files in the root
+   directory: writes to them write nothing, as for an executable
+   that is running, and creating or removing a file of the same
+   name fails (see filesys.c).  Files are never freed.  A file
+   that does not fit in kernel memory is skipped, and a file of
+   the same name on the file system disk, if any, is used
+   instead. */
+
+/* A file in the archive. */
+struct initrd_file
+  {
+    struct list_elem elem;      /* Element in files. */
+    char name[NAME_MAX + 1];    /* File name. */
+    struct inode *inode;        /* In-memory inode. */
+  };
+
+/* ustar header block.  See POSIX.1-2008 "pax", "ustar
+   Interchange Format".  Numeric fields are in octal ASCII. */
+struct ustar_header
+  {
+    char name[100];             /* File name, null-terminated if short. */
+    char mode[8];               /* Permissions. */
+    char uid[8];                /* Owner. */
+    char gid[8];                /* Group. */
+    char size[12];              /* File size in bytes. */
+    char mtime[12];             /* Last modification time. */
+    char chksum[8];             /* Sum of header bytes. */
+    char typeflag;              /* File type. */
+    char linkname[100];         /* Link target. */
+    char magic[6];              /* "ustar\0". */
+    char version[2];            /* "00". */
+    char uname[32];             /* Owner's user name. */
+    char gname[32];             /* Owner's group name. */
+    char devmajor[8];           /* Device major number. */
+    char devminor[8];           /* Device minor number. */
+    char prefix[155];           /* Directory prefix of NAME. */
+    char padding[12];           /* Unused. */
+  };
+
+static bool enabled;            /* Load the archive at boot? */
+static struct list files;       /* Files in the archive. */
+static disk_sector_t archive_sectors; /* Sectors in the archive. */
+
+/* Statistics. */
+static long long file_cnt;      /* Number of files loaded. */
+static long long byte_cnt;      /* Number of bytes loaded. */
+static long long load_ticks;    /* Timer ticks spent loading. */
+static long long open_cnt;      /* Opens satisfied from memory. */
+
+static bool parse_octal (const char *, size_t, unsigned long *);
+static bool check_header (const struct ustar_header *);
+static const char *header_name (const struct ustar_header *);
+static struct initrd_file *find_file (const char *name);
+
+/* Makes initrd_init() load the archive on the scratch disk. */
+void
+initrd_configure (void)
+{
+  enabled = true;
+}
+
+/* Loads the archive on the scratch disk into memory, if
+   initrd_configure() was called.  Must be called after
+   filesys_init(). */
+void
+initrd_init (void)
+{
+  struct ustar_header *h;
+  struct disk *disk;
+  disk_sector_t sector, inumber;
+  int64_t start = timer_ticks ();
+
+  list_init (&files);
+  if (!enabled)
+    return;
+
+  disk = disk_get (1, 0);
+  if (disk == NULL)
+    PANIC ("couldn't open initrd disk (hdc or hd1:0)");
+  h = malloc (DISK_SECTOR_SIZE);
+  if (h == NULL)
+    PANIC ("couldn't allocate initrd header");
+
+  /* Give in-memory inodes numbers past the end of the file
+     system disk, where no disk inode can be. */
+  inumber = disk_size (filesys_disk);
+  sector = 0;
+  while (sector < disk_size (disk))
+    {
+      const char *name;
+      unsigned long size;
+      size_t sector_cnt, page_cnt;
+      struct initrd_file *f;
+      void *data = NULL;
+
+      disk_read (disk, sector++, h);
+      if (h->name[0] == '\0')
+        {
+          /* Skip the second of the two zero blocks that end the
+             archive. */
+          if (sector < disk_size (disk))
+            sector++;
+          break;
+        }
+      if (!check_header (h) || !parse_octal (h->size, sizeof h->size, &size))
+        PANIC ("initrd: corrupt archive header at sector %"PRDSNu,
+               sector - 1);
+      sector_cnt = DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
+      page_cnt = DIV_ROUND_UP (size, PGSIZE);
+      name = header_name (h);
+
+      /* Directories, links and the like have nothing to load. */
+      if (h->typeflag != '0' && h->typeflag != '\0')
+        {
+          sector += sector_cnt;
+          continue;
+        }
+      if (strlen (name) > NAME_MAX || sector + sector_cnt > disk_size (disk))
+        {
+          printf ("initrd: %s: bad file name or size, skipped\n", name);
+          sector += sector_cnt;
+          continue;
+        }
+
+      /* Read the data straight into its pages. */
+      f = malloc (sizeof *f);
+      if (page_cnt > 0)
+        data = palloc_get_multiple (0, page_cnt);
+      if (f == NULL || (page_cnt > 0 && data == NULL))
+        {
+          printf ("initrd: %s: out of memory, skipped\n", name);
+          free (f);
+          if (data != NULL)
+            palloc_free_multiple (data, page_cnt);
+          sector += sector_cnt;
+          continue;
+        }
+      if (sector_cnt > 0)
+        disk_read_multiple (disk, sector, sector_cnt, data);
+      sector += sector_cnt;
+
+      strlcpy (f->name, name, sizeof f->name);
+      f->inode = inode_create_ram (inumber++, data, size);
+      if (f->inode == NULL)
+        PANIC ("initrd: %s: couldn't allocate inode", name);
+      list_push_back (&files, &f->elem);
+      file_cnt++;
+      byte_cnt += size;
+    }
+  free (h);
+
+  archive_sectors = sector;
+  load_ticks = timer_elapsed (start);
+}
+
+/* Returns a new reference to the inode of the archive file named
+   NAME, or a null pointer if the archive has no such file. */
+struct inode *
+initrd_open (const char *name)
+{
+  struct initrd_file *f = find_file (name);
+
+  if (f == NULL)
+    return NULL;
+  open_cnt++;
+  return inode_reopen (f->inode);
+}
+
+/* Returns true if the archive has a file named NAME. */
+bool
+initrd_exists (const char *name)
+{
+  return find_file (name) != NULL;
+}
+
+/* Returns the number of sectors at the start of the scratch disk
+   taken by the archive, 0 if none was loaded. */
+disk_sector_t
+initrd_size (void)
+{
+  return archive_sectors;
+}
+
+/* Returns the archive file named NAME, or a null pointer if there
+   is none. */
+static struct initrd_file *
+find_file (const char *name)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&files); e != list_end (&files); e = list_next (e))
+    {
+      struct initrd_file *f = list_entry (e, struct initrd_file, elem);
+      if (!strcmp (f->name, name))
+        return f;
+    }
+  return NULL;
+}
+
+/* Prints initrd statistics. */
+void
+initrd_print_stats (void)
+{
+  if (enabled)
+    printf ("initrd: %lld files, %lld bytes loaded in %lld ticks, "
+            "%lld opens\n", file_cnt, byte_cnt, load_ticks, open_cnt);
+}
+
+/* Parses the SIZE-byte octal field at S into *VALUE.  The field
+   may be padded with spaces or nulls.  Returns false if it holds
+   anything else. */
+static bool
+parse_octal (const char *s, size_t size, unsigned long *value)
+{
+  size_t i = 0;
+
+  *value = 0;
+  while (i < size && s[i] == ' ')
+    i++;
+  for (; i < size && s[i] >= '0' && s[i] <= '7'; i++)
+    {
+      if (*value > ULONG_MAX / 8)
+        return false;
+      *value = *value * 8 + (s[i] - '0');
+    }
+  for (; i < size; i++)
+    if (s[i] != ' ' && s[i] != '\0')
+      return false;
+  return true;
+}
+
+/* Returns true if H has the ustar magic and a correct checksum,
+   which is the sum of its bytes with the checksum field taken as
+   spaces. */
+static bool
+check_header (const struct ustar_header *h)
+{
+  const uint8_t *p = (const uint8_t *) h;
+  unsigned long chksum, sum = 0;
+  size_t i;
+
+  if (memcmp (h->magic, "ustar", 5)
+      || !parse_octal (h->chksum, sizeof h->chksum, &chksum))
+    return false;
+  for (i = 0; i < sizeof *h; i++)
+    if (i >= offsetof (struct ustar_header, chksum)
+        && i < offsetof (struct ustar_header, chksum) + sizeof h->chksum)
+      sum += ' ';
+    else
+      sum += p[i];
+  return sum == chksum;
+}
+
+/* Returns the name of the file that H describes, without a
+   leading "./".  Files in subdirectories keep their directory
+   prefix, which makes them too long to be found by name. */
+static const char *
+header_name (const struct ustar_header *h)
+{
+  static char name[sizeof h->prefix + sizeof h->name + 2];
+  const char *s;
+
+  if (h->prefix[0] != '\0')
+    snprintf (name, sizeof name, "%.*s/%.*s",
+              (int) sizeof h->prefix, h->prefix,
+              (int) sizeof h->name, h->name);
+  else
+    snprintf (name, sizeof name, "%.*s", (int) sizeof h->name, h->name);
+
+  s = name;
+  while (s[0] == '.' && s[1] == '/')
+    s += 2;
+  return s;
+}
@@ -0,0 +1,16 @@
+#ifndef FILESYS_INITRD_H
+#define FILESYS_INITRD_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+struct inode;
+
+void initrd_configure (void);
+void initrd_init (void);
+struct inode *initrd_open (const char *name);
+bool initrd_exists (const char *name);
+disk_sector_t initrd_size (void);
+void initrd_print_stats (void);
+
+#endif /* filesys/initrd.h */
@@ -36,6 +36,8 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned version;                   /* Incremented by every write. */
+    const uint8_t *ram;                 /* Contents, if in memory only. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -147,10 +149,38 @@ inode_open (disk_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->version = 0;
+  inode->ram = NULL;
   disk_read (filesys_disk, inode->sector, &inode->data);
   return inode;
 }
 
+/* Creates and returns a read-only inode whose LENGTH bytes of
+   contents are at DATA in memory rather than on disk, with
+   inode number INUMBER, which must not be a sector of the file
+   system disk.  The caller keeps the inode open for as long as
+   DATA exists.
+   Returns a null pointer if memory allocation fails. */
+struct inode *
+inode_create_ram (disk_sector_t inumber, const void *data, off_t length)
+{
+  struct inode *inode = malloc (sizeof *inode);
+  if (inode == NULL)
+    return NULL;
+
+  /* Not in open_inodes, so that inode_open() never finds it. */
+  inode->sector = inumber;
+  inode->open_cnt = 1;
+  inode->deny_write_cnt = 0;
+  inode->removed = false;
+  inode->version = 0;
+  inode->ram = data;
+  memset (&inode->data, 0, sizeof inode->data);
+  inode->data.length = length;
+  inode->data.magic = INODE_MAGIC;
+  return inode;
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
@@ -170,6 +200,22 @@ inode_get_inumber (const struct inode *inode)
   return inode->sector;
 }
 
+/* Returns INODE's version, which changes whenever its data is
+   written, so that a copy of the data can be checked for
+   staleness as long as INODE stays open. */
+unsigned
+inode_get_version (const struct inode *inode)
+{
+  return inode->version;
+}
+
+/* Returns true if INODE has been removed. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
 /* Closes INODE and writes it to disk.
    If this was the last reference to INODE, frees its memory.
    If INODE was also a removed inode, frees its blocks. */
@@ -215,6 +261,17 @@ inode_remove (struct inode *inode)
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
 {
+  if (inode->ram != NULL)
+    {
+      off_t inode_left = inode_length (inode) - offset;
+      if (size > inode_left)
+        size = inode_left;
+      if (size <= 0)
+        return 0;
+      memcpy (buffer_, inode->ram + offset, size);
+      return size;
+    }
+
   lock_acquire(&read_lock);
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
@@ -238,8 +295,15 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
       if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) 
         {
-          /* Read full sector directly into caller's buffer. */
-          disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
+          /* Read full sectors directly into caller's buffer.
+             A file's sectors are contiguous, so all of the full
+             sectors left to read can be read at once. */
+          off_t run = size < inode_left ? size : inode_left;
+          size_t sector_cnt = run / DISK_SECTOR_SIZE;
+
+          disk_read_multiple (filesys_disk, sector_idx, sector_cnt,
+                              buffer + bytes_read);
+          chunk_size = sector_cnt * DISK_SECTOR_SIZE;
         }
       else 
         {
@@ -269,7 +333,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
    (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   growth is not yet implemented.)  An inode created by
+   inode_create_ram() cannot be written at all. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
@@ -279,8 +344,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
 
-  if (inode->deny_write_cnt)
-    return 0;
+  if (inode->deny_write_cnt || inode->ram != NULL)
+    {
+      lock_release(&write_lock);
+      return 0;
+    }
 
   while (size > 0) 
     {
@@ -330,6 +398,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       bytes_written += chunk_size;
     }
   free (bounce);
+  if (bytes_written > 0)
+    inode->version++;
   lock_release(&write_lock);
   return bytes_written;
 }
@@ -0,0 +1,222 @@
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Anonymous pipes.
+
+   A pipe is a ring buffer of PIPE_SIZE bytes with a read end
+   and a write end, each of which is a `struct file' (see
+   file_open_pipe()) that may be shared through file_dup().  HEAD
+   and TAIL count the bytes ever read and written, so TAIL - HEAD
+   bytes are buffered, starting at HEAD % PIPE_SIZE.
+
+   Waking a blocked reader or writer costs a context switch, so
+   readers are woken only once PIPE_WATERMARK bytes are buffered
+   or the writer is about to block or return, and writers only
+   once PIPE_WATERMARK bytes are free or enough for what they have
+   left to write. */
+
+/* Size of a pipe's buffer. */
+#define PIPE_SIZE PGSIZE
+
+/* Wakeup threshold, in bytes. */
+#define PIPE_WATERMARK (PIPE_SIZE / 2)
+
+/* A pipe. */
+struct pipe
+  {
+    uint8_t *buf;               /* Ring buffer. */
+    size_t head;                /* Number of bytes ever read. */
+    size_t tail;                /* Number of bytes ever written. */
+    size_t wanted;              /* Space a blocked writer needs. */
+    bool reader_open;           /* Is the read end open? */
+    bool writer_open;           /* Is the write end open? */
+
+    struct lock lock;           /* Protects the members above. */
+    struct condition not_empty; /* Signaled for blocked readers. */
+    struct condition not_full;  /* Signaled for blocked writers. */
+    struct waitq waitq;         /* Woken on every change, for poll(). */
+  };
+
+/* Creates a new pipe and stores its read end in *READ_END and
+   its write end in *WRITE_END.  Returns true if successful,
+   false if memory allocation fails. */
+bool
+pipe_create (struct file **read_end, struct file **write_end)
+{
+  struct pipe *p;
+
+  *read_end = *write_end = NULL;
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return false;
+  p->buf = palloc_get_page (0);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return false;
+    }
+  p->head = p->tail = 0;
+  p->wanted = PIPE_SIZE;
+  p->reader_open = p->writer_open = true;
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  waitq_init (&p->waitq);
+
+  /* Each end owns its half of P from here on, even if opening
+     it fails. */
+  *read_end = file_open_pipe (p, false);
+  *write_end = file_open_pipe (p, true);
+  if (*read_end == NULL || *write_end == NULL)
+    {
+      file_close (*read_end);
+      file_close (*write_end);
+      *read_end = *write_end = NULL;
+      return false;
+    }
+  return true;
+}
+
+/* Reads up to SIZE bytes from pipe P into BUFFER, waiting until
+   at least one byte is available unless the write end is
+   closed.  Returns the number of bytes read, which is 0 only at
+   end of file. */
+off_t
+pipe_read (struct pipe *p, void *buffer, off_t size)
+{
+  size_t ofs, n, first;
+
+  lock_acquire (&p->lock);
+  while (p->tail == p->head && p->writer_open && size > 0)
+    cond_wait (&p->not_empty, &p->lock);
+
+  n = p->tail - p->head;
+  if (n > (size_t) size)
+    n = size;
+  ofs = p->head % PIPE_SIZE;
+  first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+  memcpy (buffer, p->buf + ofs, first);
+  memcpy ((uint8_t *) buffer + first, p->buf, n - first);
+  p->head += n;
+
+  if (n > 0)
+    {
+      size_t space = PIPE_SIZE - (p->tail - p->head);
+      if (space >= PIPE_WATERMARK || space >= p->wanted)
+        cond_broadcast (&p->not_full, &p->lock);
+    }
+  lock_release (&p->lock);
+
+  if (n > 0)
+    waitq_wake (&p->waitq);
+  return n;
+}
+
+/* Writes SIZE bytes from BUFFER into pipe P, waiting for space
+   as necessary.  Returns the number of bytes written, which is
+   less than SIZE only if the read end is closed, or -1 if it was
+   closed before anything could be written. */
+off_t
+pipe_write (struct pipe *p, const void *buffer, off_t size)
+{
+  size_t done = 0;
+  bool broken;
+
+  lock_acquire (&p->lock);
+  while (done < (size_t) size && p->reader_open)
+    {
+      size_t space = PIPE_SIZE - (p->tail - p->head);
+      size_t ofs, n, first;
+
+      if (space == 0)
+        {
+          /* Let readers drain what we have written so far. */
+          cond_broadcast (&p->not_empty, &p->lock);
+          waitq_wake (&p->waitq);
+          p->wanted = size - done;
+          cond_wait (&p->not_full, &p->lock);
+          p->wanted = PIPE_SIZE;
+          continue;
+        }
+
+      n = size - done < space ? size - done : space;
+      ofs = p->tail % PIPE_SIZE;
+      first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+      memcpy (p->buf + ofs, (const uint8_t *) buffer + done, first);
+      memcpy (p->buf, (const uint8_t *) buffer + done + first, n - first);
+      p->tail += n;
+      done += n;
+
+      if (p->tail - p->head >= PIPE_WATERMARK)
+        cond_broadcast (&p->not_empty, &p->lock);
+    }
+  if (done > 0)
+    cond_broadcast (&p->not_empty, &p->lock);
+  broken = !p->reader_open;
+  lock_release (&p->lock);
+
+  if (done > 0)
+    waitq_wake (&p->waitq);
+  return done > 0 || !broken ? (off_t) done : -1;
+}
+
+/* Closes the write end of pipe P if WRITER is true, otherwise the
+   read end, and frees P once both ends are closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool destroy;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      p->writer_open = false;
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  else
+    {
+      p->reader_open = false;
+      cond_broadcast (&p->not_full, &p->lock);
+    }
+  destroy = !p->reader_open && !p->writer_open;
+  lock_release (&p->lock);
+
+  if (destroy)
+    {
+      palloc_free_page (p->buf);
+      free (p);
+    }
+  else
+    waitq_wake (&p->waitq);
+}
+
+/* Returns true if writing to pipe P, if WRITER is true, or
+   reading from it otherwise, would not block. */
+bool
+pipe_ready (struct pipe *p, bool writer)
+{
+  bool ready;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    ready = p->tail - p->head < PIPE_SIZE || !p->reader_open;
+  else
+    ready = p->tail != p->head || !p->writer_open;
+  lock_release (&p->lock);
+
+  return ready;
+}
+
+/* Returns the wait queue that is woken whenever pipe P is read,
+   written or closed. */
+struct waitq *
+pipe_waitq (struct pipe *p)
+{
+  return &p->waitq;
+}
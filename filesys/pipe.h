@@ -0,0 +1,18 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct pipe;
+struct waitq;
+
+bool pipe_create (struct file **read_end, struct file **write_end);
+off_t pipe_read (struct pipe *, void *, off_t size);
+off_t pipe_write (struct pipe *, const void *, off_t size);
+void pipe_close (struct pipe *, bool writer);
+bool pipe_ready (struct pipe *, bool writer);
+struct waitq *pipe_waitq (struct pipe *);
+
+#endif /* filesys/pipe.h */
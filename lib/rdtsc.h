@@ -0,0 +1,17 @@
+#ifndef __LIB_RDTSC_H
+#define __LIB_RDTSC_H
+
+#include <stdint.h>
+
+/* Returns the CPU's time stamp counter, which counts clock
+   cycles, for measuring how long something takes.  Shared by the
+   kernel and user programs. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* lib/rdtsc.h */
@@ -29,7 +29,145 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions, numbered after the standard calls so that
+       those keep their numbers. */
+    SYS_FORK,                   /* Duplicate this process. */
+    SYS_MEMSTAT,                /* Report this process's memory use. */
+    SYS_MEMLIMIT,               /* Limit this process's resident pages. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+    SYS_PREAD,                  /* Read from a file at a given offset. */
+    SYS_PWRITE,                 /* Write to a file at a given offset. */
+    SYS_RING_SETUP,             /* Map a submission/completion ring. */
+    SYS_RING_ENTER,             /* Submit operations from the ring. */
+    SYS_AIO_READ,               /* Start reading from a file. */
+    SYS_AIO_WRITE,              /* Start writing to a file. */
+    SYS_AIO_WAIT,               /* Wait for a read or write to finish. */
+    SYS_COPY_FILE_RANGE,        /* Copy data from one file to another. */
+    SYS_POLL,                   /* Wait for file descriptors to be ready. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_SHM_CREATE,             /* Create a shared memory segment. */
+    SYS_SHM_ATTACH,             /* Attach a shared memory segment. */
+    SYS_SHM_DETACH,             /* Detach a shared memory segment. */
+    SYS_FUTEX_WAIT,             /* Sleep on a word of shared memory. */
+    SYS_FUTEX_WAKE,             /* Wake sleepers on a word. */
+    SYS_SPAWN,                  /* Start a process with an argv array. */
+    SYS_WAITPID,                /* Wait for any or a given child. */
+    SYS_GETRUSAGE,              /* Report resource usage. */
+    SYS_SYSENTER                /* Ask whether SYSENTER may be used. */
+  };
+
+/* A buffer for SYS_READV or SYS_WRITEV. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    unsigned iov_len;           /* Length of buffer in bytes. */
+  };
+
+/* Most buffers that SYS_READV or SYS_WRITEV accept. */
+#define IOV_MAX 16
+
+/* A file descriptor to be checked by SYS_POLL.  EVENTS says
+   what to wait for; the kernel sets REVENTS to the events that
+   are ready, which may also include POLLNVAL. */
+struct pollfd
+  {
+    int fd;                     /* File descriptor. */
+    short events;               /* Requested events. */
+    short revents;              /* Returned events. */
+  };
+
+#define POLLIN  0x01            /* Reading would not block. */
+#define POLLOUT 0x04            /* Writing would not block. */
+#define POLLNVAL 0x20           /* FD is not open. */
+
+/* Most file descriptors that SYS_POLL accepts. */
+#define POLL_MAX 32
+
+/* Flags for SYS_SPAWN. */
+#define SPAWN_NOWAIT 0x1        /* Do not wait for the program to load. */
+
+/* Options for SYS_WAITPID. */
+#define WNOHANG 0x1             /* Return 0 if no child has exited. */
+
+/* Whose usage SYS_GETRUSAGE reports. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Its children that have been waited for. */
+
+/* Resource usage of a process, as reported by SYS_GETRUSAGE.
+   For RUSAGE_CHILDREN, the sum over the children, including
+   their own waited-for children, except PEAK, the maximum. */
+struct rusage
+  {
+    long long ticks;            /* Timer ticks spent running. */
+    long long syscalls;         /* System calls made. */
+    long long read_bytes;       /* Bytes read with read() and the like. */
+    long long write_bytes;      /* Bytes written with write() and the like. */
+    long long page_faults;      /* Page faults taken. */
+    int peak;                   /* Most pages ever resident at once. */
+  };
+
+/* Operations that may be submitted through a ring. */
+enum ring_op
+  {
+    RING_OP_NOP,                /* Does nothing, result 0. */
+    RING_OP_OPEN,               /* open (buf). */
+    RING_OP_CLOSE,              /* close (fd). */
+    RING_OP_READ,               /* read (fd, buf, len). */
+    RING_OP_WRITE,              /* write (fd, buf, len). */
+    RING_OP_PREAD,              /* pread (fd, buf, len, offset). */
+    RING_OP_PWRITE              /* pwrite (fd, buf, len, offset). */
+  };
+
+/* A submitted operation. */
+struct ring_sqe
+  {
+    int op;                     /* One of RING_OP_*. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Buffer, or file name for RING_OP_OPEN. */
+    unsigned len;               /* Length of BUF in bytes. */
+    unsigned offset;            /* File offset for RING_OP_P*. */
+    unsigned user_data;         /* Copied to the completion. */
+  };
+
+/* A completed operation. */
+struct ring_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* What the system call would return. */
+  };
+
+/* Number of entries in each half of a ring. */
+#define RING_ENTRIES 64
+
+/* A submission ring and a completion ring, in a page shared by a
+   process and the kernel (see SYS_RING_SETUP).  Head and tail
+   only ever increase; entry I of a ring is at index
+   I % RING_ENTRIES.  The process fills in submissions and
+   advances SQ_TAIL, and advances CQ_HEAD as it consumes
+   completions.  The kernel advances SQ_HEAD and CQ_TAIL. */
+struct ring
+  {
+    unsigned sq_head;           /* Next submission to be consumed. */
+    unsigned sq_tail;           /* Next free submission entry. */
+    unsigned cq_head;           /* Next completion to be consumed. */
+    unsigned cq_tail;           /* Next free completion entry. */
+    struct ring_sqe sq[RING_ENTRIES]; /* Submission ring. */
+    struct ring_cqe cq[RING_ENTRIES]; /* Completion ring. */
+  };
+
+/* Memory use of a process, as reported by SYS_MEMSTAT.
+   All counts are in pages. */
+struct memstat
+  {
+    int resident;               /* Pages in memory. */
+    int swapped;                /* Pages in swap only. */
+    int shared;                 /* Resident pages shared with others. */
+    int peak;                   /* Most pages resident at once since
+                                   the last SYS_MEMLIMIT. */
+    int limit;                  /* Limit on resident pages, 0 if none. */
   };
 
 #endif /* lib/syscall-nr.h */
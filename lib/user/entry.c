@@ -6,5 +6,6 @@ void _start (int argc, char *argv[]);
 void
 _start (int argc, char *argv[]) 
 {
+  fast_syscalls (true);
   exit (main (argc, argv));
 }
@@ -1,31 +1,47 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
 
+/* Nonzero if system calls should enter the kernel with SYSENTER
+   rather than "int $0x30".  Set by fast_syscalls().  Not static
+   because it is only referenced from inline assembly. */
+char syscall_use_sysenter;
+
+/* Traps into the kernel, after the caller has pushed the system
+   call number and arguments.  Either way the kernel sees the same
+   user stack.  SYSENTER returns to the address in %edx, with the
+   stack pointer in %ecx, skipping past the "int $0x30". */
+#define SYSCALL_TRAP                                            \
+        "cmpb $0, syscall_use_sysenter; je 2f; "                \
+        "movl %%esp, %%ecx; movl $1f, %%edx; sysenter; "        \
+        "2: int $0x30; 1: "
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; "                                \
+             SYSCALL_TRAP "addl $4, %%esp"                      \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                          \
+        ({                                                              \
+          int retval;                                                   \
+          asm volatile                                                  \
+            ("pushl %[arg0]; pushl %[number]; "                         \
+             SYSCALL_TRAP "addl $8, %%esp"                              \
+               : "=a" (retval)                                          \
+               : [number] "i" (NUMBER),                                 \
+                 [arg0] "g" (ARG0)                                      \
+               : "ecx", "edx", "cc", "memory");                         \
+          retval;                                                       \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
@@ -35,12 +51,12 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP "addl $12, %%esp" \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
@@ -51,13 +67,32 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP "addl $16, %%esp" \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1),                             \
                  [arg2] "g" (ARG2)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "cc", "memory");                 \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; "                   \
+             "pushl %[arg1]; pushl %[arg0]; "                   \
+             "pushl %[number]; " SYSCALL_TRAP "addl $20, %%esp" \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [arg1] "g" (ARG1),                             \
+                 [arg2] "g" (ARG2),                             \
+                 [arg3] "g" (ARG3)                              \
+               : "ecx", "edx", "cc", "memory");                 \
           retval;                                               \
         })
 
@@ -141,6 +176,126 @@ close (int fd)
   syscall1 (SYS_CLOSE, fd);
 }
 
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+struct ring *
+ring_setup (void)
+{
+  return (struct ring *) syscall0 (SYS_RING_SETUP);
+}
+
+int
+ring_enter (unsigned to_submit, unsigned min_complete)
+{
+  return syscall2 (SYS_RING_ENTER, to_submit, min_complete);
+}
+
+int
+aio_read (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_AIO_READ, fd, buffer, size, offset);
+}
+
+int
+aio_write (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_AIO_WRITE, fd, buffer, size, offset);
+}
+
+int
+aio_wait (int id)
+{
+  return syscall1 (SYS_AIO_WAIT, id);
+}
+
+int
+copy_file_range (int in_fd, int out_fd, unsigned size)
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, in_fd, out_fd, size);
+}
+
+int
+poll (struct pollfd *fds, unsigned nfds, int timeout)
+{
+  return syscall3 (SYS_POLL, fds, nfds, timeout);
+}
+
+int
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+void *
+shm_create (int key, unsigned size)
+{
+  return (void *) syscall2 (SYS_SHM_CREATE, key, size);
+}
+
+void *
+shm_attach (int key)
+{
+  return (void *) syscall1 (SYS_SHM_ATTACH, key);
+}
+
+bool
+shm_detach (void *addr)
+{
+  return syscall1 (SYS_SHM_DETACH, addr);
+}
+
+int
+futex_wait (int *addr, int val)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, val);
+}
+
+int
+futex_wake (int *addr, int cnt)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+pid_t
+spawn (const char *file, char *const argv[], int flags)
+{
+  return syscall3 (SYS_SPAWN, file, argv, flags);
+}
+
+pid_t
+waitpid (pid_t pid, int *status, int options)
+{
+  return syscall3 (SYS_WAITPID, pid, status, options);
+}
+
+int
+getrusage (int who, struct rusage *usage)
+{
+  return syscall2 (SYS_GETRUSAGE, who, usage);
+}
+
 mapid_t
 mmap (int fd, void *addr)
 {
@@ -153,6 +308,24 @@ munmap (mapid_t mapid)
   syscall1 (SYS_MUNMAP, mapid);
 }
 
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+void
+memstat (struct memstat *usage)
+{
+  syscall1 (SYS_MEMSTAT, usage);
+}
+
+int
+memlimit (int pages)
+{
+  return syscall1 (SYS_MEMLIMIT, pages);
+}
+
 bool
 chdir (const char *dir)
 {
@@ -182,3 +355,15 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+/* Makes later system calls enter the kernel with SYSENTER if
+   ENABLE is true and the kernel has set it up, or with "int $0x30"
+   otherwise.  Returns true if SYSENTER is now in use. */
+bool
+fast_syscalls (bool enable)
+{
+  syscall_use_sysenter = false;
+  if (enable)
+    syscall_use_sysenter = syscall0 (SYS_SYSENTER);
+  return syscall_use_sysenter;
+}
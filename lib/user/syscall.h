@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,10 +38,34 @@ int write (int fd, const void *buffer, unsigned length);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+struct ring *ring_setup (void);
+int ring_enter (unsigned to_submit, unsigned min_complete);
+int aio_read (int fd, void *buffer, unsigned length, unsigned offset);
+int aio_write (int fd, const void *buffer, unsigned length, unsigned offset);
+int aio_wait (int id);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+int poll (struct pollfd *, unsigned nfds, int timeout);
+int pipe (int fds[2]);
+void *shm_create (int key, unsigned size);
+void *shm_attach (int key);
+bool shm_detach (void *addr);
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int cnt);
+pid_t spawn (const char *file, char *const argv[], int flags);
+pid_t waitpid (pid_t, int *status, int options);
+int getrusage (int who, struct rusage *);
+bool fast_syscalls (bool enable);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap (int fd, void *addr);
 void munmap (mapid_t);
+pid_t fork (void);
+void memstat (struct memstat *);
+int memlimit (int pages);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
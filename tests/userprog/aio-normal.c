@@ -0,0 +1,37 @@
+/* Writes sample.txt's contents to a new file with two concurrent
+   aio_write() requests, then reads it back with two concurrent
+   aio_read() requests, waiting for each request out of order. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const int size = sizeof sample - 1;
+  const int half = size / 2;
+  char buf[sizeof sample];
+  int handle, id[2];
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  CHECK ((id[0] = aio_write (handle, sample, half, 0)) >= 0, "aio_write");
+  CHECK ((id[1] = aio_write (handle, sample + half, size - half, half)) >= 0,
+         "aio_write");
+  CHECK (aio_wait (id[1]) == size - half, "aio_wait");
+  CHECK (aio_wait (id[0]) == half, "aio_wait");
+  CHECK (aio_wait (id[0]) == -1, "aio_wait again fails");
+  check_file ("test.txt", sample, size);
+
+  memset (buf, 0, sizeof buf);
+  CHECK ((id[0] = aio_read (handle, buf, half, 0)) >= 0, "aio_read");
+  CHECK ((id[1] = aio_read (handle, buf + half, sizeof buf, half)) >= 0,
+         "aio_read");
+  CHECK (aio_wait (id[1]) == size - half, "aio_wait");
+  CHECK (aio_wait (id[0]) == half, "aio_wait");
+  compare_bytes (buf, sample, size, 0, "test.txt");
+}
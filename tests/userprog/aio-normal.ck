@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-normal) begin
+(aio-normal) create "test.txt"
+(aio-normal) open "test.txt"
+(aio-normal) aio_write
+(aio-normal) aio_write
+(aio-normal) aio_wait
+(aio-normal) aio_wait
+(aio-normal) aio_wait again fails
+(aio-normal) open "test.txt" for verification
+(aio-normal) verified contents of "test.txt"
+(aio-normal) close "test.txt"
+(aio-normal) aio_read
+(aio-normal) aio_read
+(aio-normal) aio_wait
+(aio-normal) aio_wait
+(aio-normal) end
+aio-normal: exit(0)
+EOF
+pass;
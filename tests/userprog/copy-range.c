@@ -0,0 +1,25 @@
+/* Copies sample.txt to a new file with copy_file_range(), in two
+   pieces, and checks the copy. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const int size = sizeof sample - 1;
+  int in_fd, out_fd;
+
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((out_fd = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  CHECK (copy_file_range (in_fd, out_fd, 100) == 100, "copy 100 bytes");
+  CHECK (copy_file_range (in_fd, out_fd, 1000) == size - 100,
+         "copy rest of file");
+  CHECK (copy_file_range (in_fd, STDOUT_FILENO, 1) == -1,
+         "copy to console fails");
+  check_file ("test.txt", sample, size);
+}
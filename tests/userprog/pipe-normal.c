@@ -0,0 +1,38 @@
+/* Writes to a pipe and reads the data back, checks poll() on
+   both ends, and checks end of file once the write end is
+   closed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct pollfd pfd;
+  char buf[16];
+  int fds[2];
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (fds[0] > 1 && fds[1] > 1 && fds[0] != fds[1],
+         "pipe returned two file descriptors");
+
+  pfd.fd = fds[0];
+  pfd.events = POLLIN;
+  CHECK (poll (&pfd, 1, 0) == 0, "empty pipe is not readable");
+
+  CHECK (write (fds[1], "hello", 5) == 5, "write 5 bytes");
+  CHECK (poll (&pfd, 1, 0) == 1 && pfd.revents == POLLIN,
+         "pipe is readable");
+  CHECK (read (fds[0], buf, sizeof buf) == 5, "read 5 bytes");
+  if (memcmp (buf, "hello", 5))
+    fail ("read wrong data");
+
+  CHECK (write (fds[0], "x", 1) == -1, "write to read end fails");
+  CHECK (read (fds[1], buf, 1) == -1, "read from write end fails");
+
+  close (fds[1]);
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "end of file after close");
+  close (fds[0]);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-normal) begin
+(pipe-normal) pipe
+(pipe-normal) pipe returned two file descriptors
+(pipe-normal) empty pipe is not readable
+(pipe-normal) write 5 bytes
+(pipe-normal) pipe is readable
+(pipe-normal) read 5 bytes
+(pipe-normal) write to read end fails
+(pipe-normal) read from write end fails
+(pipe-normal) end of file after close
+(pipe-normal) end
+pipe-normal: exit(0)
+EOF
+pass;
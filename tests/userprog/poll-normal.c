@@ -0,0 +1,32 @@
+/* Polls the console, a file and a bad file descriptor, and
+   checks that a poll with nothing ready times out. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct pollfd fds[3];
+  int fd;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  fds[0].fd = STDOUT_FILENO;
+  fds[0].events = POLLOUT;
+  fds[1].fd = fd;
+  fds[1].events = POLLIN;
+  fds[2].fd = 1234;
+  fds[2].events = POLLIN;
+  CHECK (poll (fds, 3, -1) == 3, "poll console, file and bad fd");
+  CHECK (fds[0].revents == POLLOUT, "console is writable");
+  CHECK (fds[1].revents == POLLIN, "file is readable");
+  CHECK (fds[2].revents == POLLNVAL, "bad fd is invalid");
+
+  fds[0].fd = STDIN_FILENO;
+  fds[0].events = POLLIN;
+  CHECK (poll (fds, 1, 0) == 0, "poll empty console");
+  CHECK (poll (fds, 1, 50) == 0, "poll empty console for 50 ms");
+  CHECK (fds[0].revents == 0, "console is not readable");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(poll-normal) begin
+(poll-normal) open "sample.txt"
+(poll-normal) poll console, file and bad fd
+(poll-normal) console is writable
+(poll-normal) file is readable
+(poll-normal) bad fd is invalid
+(poll-normal) poll empty console
+(poll-normal) poll empty console for 50 ms
+(poll-normal) console is not readable
+(poll-normal) end
+poll-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Writes sample.txt's contents to a new file with pwrite(), back
+   half first, then reads parts of it back with pread(), checking
+   that neither call moves the file position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const size_t size = sizeof sample - 1;
+  const size_t half = size / 2;
+  char buf[sizeof sample];
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  byte_cnt = pwrite (handle, sample + half, size - half, half);
+  if (byte_cnt != (int) (size - half))
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, size - half);
+  byte_cnt = pwrite (handle, sample, half, 0);
+  if (byte_cnt != (int) half)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, half);
+  if (tell (handle) != 0)
+    fail ("pwrite() moved file position to %u", tell (handle));
+  check_file ("test.txt", sample, size);
+
+  byte_cnt = pread (handle, buf, 50, 100);
+  if (byte_cnt != 50)
+    fail ("pread() returned %d instead of 50", byte_cnt);
+  compare_bytes (buf, sample + 100, 50, 100, "test.txt");
+  byte_cnt = pread (handle, buf, sizeof buf, size);
+  if (byte_cnt != 0)
+    fail ("pread() at end of file returned %d instead of 0", byte_cnt);
+  if (tell (handle) != 0)
+    fail ("pread() moved file position to %u", tell (handle));
+  msg ("pread \"test.txt\"");
+}
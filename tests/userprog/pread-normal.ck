@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-normal) begin
+(pread-normal) create "test.txt"
+(pread-normal) open "test.txt"
+(pread-normal) open "test.txt" for verification
+(pread-normal) verified contents of "test.txt"
+(pread-normal) close "test.txt"
+(pread-normal) pread "test.txt"
+(pread-normal) end
+pread-normal: exit(0)
+EOF
+pass;
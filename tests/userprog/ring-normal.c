@@ -0,0 +1,70 @@
+/* Submits a batch of operations through a ring: opens a new file,
+   writes sample.txt's contents to it, reads part of it back, and
+   closes it, then checks the completions. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Adds an operation to RING's submission ring. */
+static void
+submit (struct ring *ring, int op, int fd, void *buf, unsigned len,
+        unsigned offset) 
+{
+  struct ring_sqe *sqe = &ring->sq[ring->sq_tail % RING_ENTRIES];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = ring->sq_tail;
+  ring->sq_tail++;
+}
+
+/* Consumes the next completion from RING and checks that it
+   is for submission USER_DATA and has result RESULT. */
+static void
+check_completion (struct ring *ring, unsigned user_data, int result) 
+{
+  struct ring_cqe *cqe;
+
+  if (ring->cq_head == ring->cq_tail)
+    fail ("completion %u missing", user_data);
+  cqe = &ring->cq[ring->cq_head++ % RING_ENTRIES];
+  if (cqe->user_data != user_data || cqe->result != result)
+    fail ("completion %u has result %d, expected completion %u, "
+          "result %d", cqe->user_data, cqe->result, user_data, result);
+}
+
+void
+test_main (void) 
+{
+  const size_t size = sizeof sample - 1;
+  char buf[sizeof sample];
+  struct ring *ring;
+  int handle;
+
+  CHECK ((ring = ring_setup ()) != NULL, "ring_setup");
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  submit (ring, RING_OP_NOP, 0, NULL, 0, 0);
+  submit (ring, RING_OP_WRITE, handle, (void *) sample, size, 0);
+  submit (ring, RING_OP_PREAD, handle, buf, 50, 100);
+  submit (ring, RING_OP_CLOSE, handle, NULL, 0, 0);
+  submit (ring, RING_OP_OPEN, 0, "test.txt", 0, 0);
+  CHECK (ring_enter (5, 5) == 5, "ring_enter");
+
+  check_completion (ring, 0, 0);
+  check_completion (ring, 1, size);
+  check_completion (ring, 2, 50);
+  check_completion (ring, 3, 0);
+  if (ring->cq_head == ring->cq_tail)
+    fail ("completion 4 missing");
+  CHECK (ring->cq[ring->cq_head++ % RING_ENTRIES].result > 1,
+         "open \"test.txt\" through ring");
+  compare_bytes (buf, sample + 100, 50, 100, "test.txt");
+  check_file ("test.txt", sample, size);
+}
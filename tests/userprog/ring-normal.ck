@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-normal) begin
+(ring-normal) ring_setup
+(ring-normal) create "test.txt"
+(ring-normal) open "test.txt"
+(ring-normal) ring_enter
+(ring-normal) open "test.txt" through ring
+(ring-normal) open "test.txt" for verification
+(ring-normal) verified contents of "test.txt"
+(ring-normal) close "test.txt"
+(ring-normal) end
+ring-normal: exit(0)
+EOF
+pass;
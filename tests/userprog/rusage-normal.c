@@ -0,0 +1,39 @@
+/* Checks that getrusage() counts the bytes a process reads and
+   the system calls of a child once it has been waited for, and
+   that it rejects an invalid WHO. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct rusage before, after, children;
+  char buf[512];
+  int handle, n;
+
+  CHECK (getrusage (RUSAGE_SELF, &before) == 0, "getrusage (RUSAGE_SELF)");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  n = read (handle, buf, sizeof buf);
+  close (handle);
+  CHECK (getrusage (RUSAGE_SELF, &after) == 0, "getrusage (RUSAGE_SELF)");
+  if (after.read_bytes - before.read_bytes != n)
+    fail ("read %d bytes but read_bytes grew by %lld",
+          n, after.read_bytes - before.read_bytes);
+  if (after.syscalls <= before.syscalls)
+    fail ("syscalls did not grow");
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &children) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  if (children.syscalls != 0)
+    fail ("children made %lld syscalls before any was started",
+          children.syscalls);
+  wait (exec ("child-simple"));
+  CHECK (getrusage (RUSAGE_CHILDREN, &children) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  if (children.syscalls <= 0)
+    fail ("waited-for child made no syscalls");
+
+  msg ("getrusage (42) = %d", getrusage (42, &children));
+}
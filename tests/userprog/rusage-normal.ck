@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rusage-normal) begin
+(rusage-normal) getrusage (RUSAGE_SELF)
+(rusage-normal) open "sample.txt"
+(rusage-normal) getrusage (RUSAGE_SELF)
+(rusage-normal) getrusage (RUSAGE_CHILDREN)
+(child-simple) run
+child-simple: exit(81)
+(rusage-normal) getrusage (RUSAGE_CHILDREN)
+(rusage-normal) getrusage (42) = -1
+(rusage-normal) end
+rusage-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,35 @@
+/* Creates a shared memory segment, attaches it a second time,
+   and checks that both attachments see the same memory, that
+   futex_wait() returns at once when the value differs, and that
+   the segment goes away on last detach. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define KEY 42
+
+void
+test_main (void) 
+{
+  int *a, *b;
+
+  CHECK ((a = shm_create (KEY, 8192)) != NULL, "shm_create");
+  CHECK (shm_create (KEY, 4096) == NULL, "shm_create same key fails");
+  CHECK ((b = shm_attach (KEY)) != NULL, "shm_attach");
+  CHECK (a != b, "attached at a different address");
+
+  a[0] = 123;
+  a[2048] = 456;
+  CHECK (b[0] == 123 && b[2048] == 456, "attachments share memory");
+
+  CHECK (futex_wait (&b[0], 0) == -1, "futex_wait on other value returns");
+  CHECK (futex_wake (&a[0], 1) == 0, "futex_wake with no waiters");
+  CHECK (futex_wait ((int *) &test_name, 0) == -1,
+         "futex_wait outside segment fails");
+
+  CHECK (shm_detach (a), "shm_detach first attachment");
+  CHECK (b[0] == 123, "second attachment still valid");
+  CHECK (shm_detach (b), "shm_detach second attachment");
+  CHECK (shm_attach (KEY) == NULL, "segment freed on last detach");
+}
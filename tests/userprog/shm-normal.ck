@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-normal) begin
+(shm-normal) shm_create
+(shm-normal) shm_create same key fails
+(shm-normal) shm_attach
+(shm-normal) attached at a different address
+(shm-normal) attachments share memory
+(shm-normal) futex_wait on other value returns
+(shm-normal) futex_wake with no waiters
+(shm-normal) futex_wait outside segment fails
+(shm-normal) shm_detach first attachment
+(shm-normal) second attachment still valid
+(shm-normal) shm_detach second attachment
+(shm-normal) segment freed on last detach
+(shm-normal) end
+shm-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,21 @@
+/* Spawns a child with an argument that contains a space, which
+   exec() could not pass, and checks that spawning a missing
+   program fails with and without SPAWN_NOWAIT. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static char *const argv[] = { "child-args", "two words", NULL };
+  static char *const missing[] = { "no-such-file", NULL };
+  pid_t pid;
+
+  CHECK ((pid = spawn ("child-args", argv, 0)) > 0, "spawn");
+  CHECK (wait (pid) == 0, "wait for child");
+  CHECK (spawn ("no-such-file", missing, 0) == -1, "spawn missing program");
+  CHECK (wait (spawn ("no-such-file", missing, SPAWN_NOWAIT)) == -1,
+         "spawn missing program without waiting");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-args) begin
+(args) begin
+(args) argc = 2
+(args) argv[0] = 'child-args'
+(args) argv[1] = 'two words'
+(args) argv[2] = null
+(args) end
+child-args: exit(0)
+(spawn-args) spawn
+(spawn-args) wait for child
+load: no-such-file: open failed
+(spawn-args) spawn missing program
+load: no-such-file: open failed
+(spawn-args) spawn missing program without waiting
+(spawn-args) end
+spawn-args: exit(0)
+EOF
+pass;
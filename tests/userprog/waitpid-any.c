@@ -0,0 +1,31 @@
+/* Starts two children and reaps them with waitpid(-1), which
+   must return each of them once, with its exit status.  After
+   that, waitpid(-1), with or without WNOHANG, and wait() on
+   either child must return -1 at once. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t children[2], reaped[2];
+  int status[2];
+  int i;
+
+  for (i = 0; i < 2; i++)
+    if ((children[i] = exec ("child-simple")) == PID_ERROR)
+      fail ("exec child-simple");
+  for (i = 0; i < 2; i++)
+    reaped[i] = waitpid (-1, &status[i], 0);
+
+  if (!((reaped[0] == children[0] && reaped[1] == children[1])
+        || (reaped[0] == children[1] && reaped[1] == children[0])))
+    fail ("waitpid(-1) returned %d and %d for children %d and %d",
+          reaped[0], reaped[1], children[0], children[1]);
+  msg ("exit statuses %d and %d", status[0], status[1]);
+  msg ("waitpid(-1) = %d", waitpid (-1, &status[0], 0));
+  msg ("waitpid(-1, WNOHANG) = %d", waitpid (-1, NULL, WNOHANG));
+  msg ("wait(child) = %d", wait (children[0]));
+}
@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(waitpid-any) begin
+(child-simple) run
+child-simple: exit(81)
+(child-simple) run
+child-simple: exit(81)
+(waitpid-any) exit statuses 81 and 81
+(waitpid-any) waitpid(-1) = -1
+(waitpid-any) waitpid(-1, WNOHANG) = -1
+(waitpid-any) wait(child) = -1
+(waitpid-any) end
+waitpid-any: exit(0)
+EOF
+(waitpid-any) begin
+(child-simple) run
+(child-simple) run
+child-simple: exit(81)
+child-simple: exit(81)
+(waitpid-any) exit statuses 81 and 81
+(waitpid-any) waitpid(-1) = -1
+(waitpid-any) waitpid(-1, WNOHANG) = -1
+(waitpid-any) wait(child) = -1
+(waitpid-any) end
+waitpid-any: exit(0)
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Forks a child that checks that it sees the parent's data,
+   overwrites it and reads from a file inherited from the parent.
+   Verifies that the parent's copy of the data is unchanged and
+   that the file position is shared with the child. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (3 * 4096)
+
+static char data[SIZE];
+
+void
+test_main (void)
+{
+  char buf[16];
+  int handle;
+  pid_t child;
+  size_t i;
+
+  memset (data, 'a', SIZE);
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  CHECK ((child = fork ()) != -1, "fork");
+  if (child == 0)
+    {
+      /* Child.  Stays silent, so that the output does not depend
+         on scheduling. */
+      for (i = 0; i < SIZE; i++)
+        if (data[i] != 'a')
+          exit (1);
+      memset (data, 'b', SIZE);
+      if (read (handle, buf, sizeof buf) != sizeof buf
+          || memcmp (buf, sample, sizeof buf))
+        exit (2);
+      exit (81);
+    }
+  quiet = true;
+  CHECK (wait (child) == 81, "wait for child (should return 81)");
+  quiet = false;
+
+  for (i = 0; i < SIZE; i++)
+    if (data[i] != 'a')
+      fail ("byte %zu of parent's data changed to '%c' by child",
+            i, data[i]);
+  CHECK (tell (handle) == sizeof buf, "file position shared with child");
+}
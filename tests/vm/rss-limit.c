@@ -0,0 +1,43 @@
+/* Limits the process to a few resident pages, which evicts the
+   rest of its memory, including the buffer it already had
+   resident since it was loaded, then writes and reads back that
+   buffer, several times the limit in size.  Verifies that the
+   data survives being reclaimed and that the process never holds
+   more pages than its limit from then on. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LIMIT 32
+#define PAGES 128
+#define SIZE (PAGES * 4096)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  struct memstat usage;
+  size_t i;
+
+  CHECK (memlimit (LIMIT) == 0, "limit to %d resident pages", LIMIT);
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 251;
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char) (i % 251))
+      fail ("byte %zu is %d, should be %d", i, buf[i], (int) (i % 251));
+  msg ("%d pages written and read back", PAGES);
+
+  memstat (&usage);
+  if (usage.limit != LIMIT)
+    fail ("limit is %d, should be %d", usage.limit, LIMIT);
+  if (usage.resident > LIMIT || usage.peak > LIMIT)
+    fail ("%d pages resident, peak %d, over limit of %d",
+          usage.resident, usage.peak, LIMIT);
+  if (usage.swapped < PAGES - LIMIT)
+    fail ("only %d pages swapped", usage.swapped);
+  msg ("resident pages stayed within limit");
+}
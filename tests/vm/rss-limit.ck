@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) limit to 32 resident pages
+(rss-limit) 128 pages written and read back
+(rss-limit) resident pages stayed within limit
+(rss-limit) end
+EOF
+pass;
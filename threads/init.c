@@ -21,9 +21,12 @@
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
+#include "userprog/aio.h"
+#include "userprog/shm.h"
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/image.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
@@ -31,8 +34,14 @@
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "devices/zram.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/initrd.h"
+#endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
 #endif
 
 /* Amount of physical memory, in 4 kB pages. */
@@ -54,6 +63,9 @@ static void paging_init (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
+#ifdef FILESYS
+static void parse_zram (char *);
+#endif
 static void run_actions (char **argv);
 static void usage (void);
 
@@ -102,6 +114,7 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -112,7 +125,23 @@ main (void)
 #ifdef FILESYS
   /* Initialize file system. */
   disk_init ();
+  zram_init ();
   filesys_init (format_filesys);
+  initrd_init ();
+#endif
+
+#ifdef VM
+  /* Initialize virtual memory. */
+  frame_init ();
+  swap_init ();
+#endif
+
+#ifdef USERPROG
+  /* Start asynchronous I/O workers and set up shared memory and
+     the executable image cache. */
+  aio_init ();
+  shm_init ();
+  image_init ();
 #endif
 
   printf ("Boot complete.\n");
@@ -143,11 +172,34 @@ ram_init (void)
   ram_pages = *(uint32_t *) ptov (LOADER_RAM_PGS);
 }
 
+/* CPUID feature flag (EDX of leaf 1) for 4 MB pages. */
+#define CPUID_PSE 0x00000008
+
+/* CR4 bit that enables 4 MB pages. */
+#define CR4_PSE 0x00000010
+
+/* Returns true if the CPU supports 4 MB pages. */
+static bool
+cpu_has_pse (void) 
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & CPUID_PSE) != 0;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points base_page_dir to the page
    directory it creates.
 
+   If the CPU supports it, every 4 MB of RAM that is aligned, lies
+   entirely in RAM and holds no kernel code is mapped by a single
+   large PDE instead of a page table, which saves a page table
+   and makes each kernel TLB entry cover 1024 times more memory.
+   The kernel code stays in 4 kB pages so that it can be mapped
+   read-only.
+
    At the time this function is called, the active page table
    (set up by loader.S) only maps the first 4 MB of RAM, so we
    should not try to use extravagant amounts of memory.
@@ -158,6 +210,8 @@ paging_init (void)
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  const size_t large_pages = PTSPAN / PGSIZE;
+  bool use_large = cpu_has_pse ();
 
   pd = base_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,6 +225,13 @@ paging_init (void)
 
       if (pd[pde_idx] == 0)
         {
+          if (use_large && pte_idx == 0 && page + large_pages <= ram_pages
+              && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+            {
+              pd[pde_idx] = pde_create_large (vaddr, true);
+              page += large_pages - 1;
+              continue;
+            }
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
@@ -178,6 +239,17 @@ paging_init (void)
       pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
     }
 
+  /* Large PDEs are only valid with CR4.PSE set.  The page table
+     set up by loader.S has none, so it is safe to set it
+     first.  See [IA32-v3a] 3.7.3 "Mixing 4-KByte and 4-MByte
+     Pages". */
+  if (use_large)
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -239,6 +311,10 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-zram"))
+        parse_zram (value);
+      else if (!strcmp (name, "-initrd"))
+        initrd_configure ();
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
@@ -247,6 +323,12 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-rusage"))
+        process_report_usage = true;
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-memstat"))
+        process_report_memory = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -255,6 +337,26 @@ parse_options (char **argv)
   return argv;
 }
 
+#ifdef FILESYS
+/* Parses VALUE, the argument to the -zram option, which has the
+   form CHAN:DEV[:PAGES]. */
+static void
+parse_zram (char *value) 
+{
+  char *save_ptr;
+  char *chan, *dev, *pages;
+
+  if (value == NULL)
+    PANIC ("-zram requires an argument (use -h for help)");
+  chan = strtok_r (value, ":", &save_ptr);
+  dev = strtok_r (NULL, ":", &save_ptr);
+  pages = strtok_r (NULL, "", &save_ptr);
+  if (chan == NULL || dev == NULL)
+    PANIC ("bad -zram argument (use -h for help)");
+  zram_configure (atoi (chan), atoi (dev), pages != NULL ? atoi (pages) : 0);
+}
+#endif
+
 /* Runs the task specified in ARGV[1]. */
 static void
 run_task (char **argv)
@@ -347,10 +449,20 @@ usage (void)
           "  -h                 Print this help message and power off.\n"
           "  -q                 Power off VM after actions or on panic.\n"
           "  -f                 Format file system disk during startup.\n"
+#ifdef FILESYS
+          "  -zram=C:D[:PAGES]  Replace disk hdC:D by a compressed RAM disk\n"
+          "                     of up to PAGES pages that spills to it.\n"
+          "  -initrd            Load the ustar archive on the scratch disk\n"
+          "                     into a read-only in-memory file system.\n"
+#endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -rusage            Report resource use of each process at exit.\n"
+#endif
+#ifdef VM
+          "  -memstat           Report memory use of each process at exit.\n"
 #endif
           );
   power_off ();
@@ -367,6 +479,7 @@ power_off (void)
 
 #ifdef FILESYS
   filesys_done ();
+  zram_done ();
 #endif
 
   print_stats ();
@@ -387,12 +500,21 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  palloc_print_stats ();
 #ifdef FILESYS
   disk_print_stats ();
+  zram_print_stats ();
+  initrd_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  syscall_print_stats ();
+  image_print_stats ();
+#endif
+#ifdef VM
+  frame_print_stats ();
+  swap_print_stats ();
 #endif
 }
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,26 +24,60 @@
    even if user processes are swapping like mad.
 
    By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   half to the user pool at startup.  Neither pool keeps its
+   share for good, though: when a pool runs out of pages, it
+   borrows a chunk of CHUNK_PAGES free pages from the other one,
+   as long as that leaves the lender with at least its reserve
+   of free pages and at least half of the pages it started with.
+   A pool lends only chunks that it owns entirely and that are
+   entirely free, so memory moves between the pools in large,
+   aligned pieces.  A borrowed chunk goes back to the pool it
+   started in as soon as it is entirely free again, and that pool
+   may also take it back, without regard to the reserve, whenever
+   it runs short and the chunk is free.
+
+   Each pool's USED_MAP covers all of the allocatable memory,
+   and a page owned by the other pool is marked as used in it.
+   USER_OWNED tells which pool a page belongs to. */
+
+/* Number of pages in a chunk, the unit of lending. */
+#define CHUNK_PAGES 16
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
-    uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for messages. */
+    struct bitmap *used_map;            /* Bitmap of unavailable pages. */
+    size_t page_cnt;                    /* Number of pages owned. */
+    size_t max_pages;                   /* Maximum pages to own. */
+    size_t reserve;                     /* Free pages kept when lending. */
+    size_t min_pages;                   /* Fewest pages to own when lending. */
+
+    /* Statistics. */
+    long long miss_cnt;                 /* # of allocations short of pages. */
+    long long borrow_cnt;               /* # of chunks borrowed. */
+    long long return_cnt;               /* # of borrowed chunks returned. */
+    long long fail_cnt;                 /* # of allocations that failed. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
-struct pool kernel_pool, user_pool;
+static struct pool kernel_pool, user_pool;
+
+static struct lock palloc_lock;         /* Mutual exclusion. */
+static uint8_t *base;                   /* First allocatable page. */
+static size_t page_cnt;                 /* Number of allocatable pages. */
+static struct bitmap *user_owned;       /* Pages owned by user pool. */
+static size_t user_start;               /* First page the user pool owned. */
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
 
-static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
-static bool page_from_pool (const struct pool *, void *page);
+static struct bitmap *carve_bitmap (uint8_t **buf, size_t *buf_size);
+static void init_pool (struct pool *, const char *name,
+                       size_t start, size_t cnt, size_t max_pages);
+static bool borrow_chunk (struct pool *);
+static struct pool *home_pool (size_t page_idx);
+static void move_chunk (struct pool *from, struct pool *to, size_t chunk);
 
 /* Initializes the page allocator. */
 void
@@ -56,24 +91,41 @@ palloc_init (void)
   uint8_t *free_start = pg_round_up (&_end);
   uint8_t *free_end = ptov (ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  size_t bm_pages, user_pages, kernel_pages;
+  uint8_t *bm_buf;
+  size_t bm_size;
+
+  /* Put the bitmaps at the beginning of free memory. */
+  bm_pages = DIV_ROUND_UP (3 * bitmap_buf_size (free_pages), PGSIZE);
+  if (bm_pages > free_pages)
+    PANIC ("Not enough memory for page allocator bitmaps.");
+  base = free_start + bm_pages * PGSIZE;
+  page_cnt = free_pages - bm_pages;
+  bm_buf = free_start;
+  bm_size = bm_pages * PGSIZE;
+  kernel_pool.used_map = carve_bitmap (&bm_buf, &bm_size);
+  user_pool.used_map = carve_bitmap (&bm_buf, &bm_size);
+  user_owned = carve_bitmap (&bm_buf, &bm_size);
+  lock_init (&palloc_lock);
 
   /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
+  user_pages = page_cnt / 2;
+  if (user_pages > user_page_limit)
+    user_pages = user_page_limit;
+  kernel_pages = page_cnt - user_pages;
+  user_start = kernel_pages;
+  init_pool (&kernel_pool, "kernel pool", 0, kernel_pages, SIZE_MAX);
+  init_pool (&user_pool, "user pool", kernel_pages, user_pages,
+             user_page_limit);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   otherwise from the kernel pool.  If the pool is short of
+   pages, it borrows from the other one.  If PAL_ZERO is set in
+   FLAGS, then the pages are filled with zeros.  If too few pages
+   are available, returns a null pointer, unless PAL_ASSERT is
+   set in FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
@@ -84,12 +136,25 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
+  lock_acquire (&palloc_lock);
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if (page_idx == BITMAP_ERROR)
+    {
+      /* Borrowed chunks need not be next to each other, so give
+         up after borrowing as many as PAGE_CNT pages would
+         fill. */
+      size_t tries = DIV_ROUND_UP (page_cnt, CHUNK_PAGES);
+
+      pool->miss_cnt++;
+      while (page_idx == BITMAP_ERROR && tries-- > 0 && borrow_chunk (pool))
+        page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      if (page_idx == BITMAP_ERROR)
+        pool->fail_cnt++;
+    }
+  lock_release (&palloc_lock);
 
   if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+    pages = base + PGSIZE * page_idx;
   else
     pages = NULL;
 
@@ -131,14 +196,13 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED ();
+  ASSERT ((uint8_t *) pages >= base);
+  page_idx = pg_no (pages) - pg_no (base);
+  ASSERT (page_idx + page_cnt <= bitmap_size (user_owned));
 
-  page_idx = pg_no (pages) - pg_no (pool->base);
+  /* Pages that are in use cannot change pools, so this needs no
+     lock. */
+  pool = bitmap_test (user_owned, page_idx) ? &user_pool : &kernel_pool;
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
@@ -146,6 +210,25 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+
+  /* Give borrowed chunks that are now entirely free back to the
+     pool they came from, if that can be done without waiting.
+     Otherwise that pool takes them back when it runs short. */
+  if (pool != home_pool (page_idx) && intr_get_level () == INTR_ON
+      && lock_try_acquire (&palloc_lock))
+    {
+      size_t chunk = page_idx / CHUNK_PAGES * CHUNK_PAGES;
+
+      for (; chunk < page_idx + page_cnt; chunk += CHUNK_PAGES)
+        if (bitmap_test (user_owned, chunk) == (pool == &user_pool)
+            && home_pool (chunk) != pool
+            && bitmap_none (pool->used_map, chunk, CHUNK_PAGES))
+          {
+            move_chunk (pool, home_pool (chunk), chunk);
+            pool->return_cnt++;
+          }
+      lock_release (&palloc_lock);
+    }
 }
 
 /* Frees the page at PAGE. */
@@ -155,35 +238,116 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  struct pool *pools[] = { &kernel_pool, &user_pool };
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    printf ("Palloc: %s: %zu pages, %lld misses, %lld chunks borrowed, "
+            "%lld returned, %lld failures\n", pools[i]->name,
+            pools[i]->page_cnt, pools[i]->miss_cnt, pools[i]->borrow_cnt,
+            pools[i]->return_cnt, pools[i]->fail_cnt);
+}
+
+/* Creates a bitmap of PAGE_CNT bits in the *BUF_SIZE bytes at
+   *BUF, and advances *BUF past it. */
+static struct bitmap *
+carve_bitmap (uint8_t **buf, size_t *buf_size) 
+{
+  size_t size = bitmap_buf_size (page_cnt);
+  struct bitmap *b;
+
+  ASSERT (size <= *buf_size);
+  b = bitmap_create_in_buf (page_cnt, *buf, size);
+  *buf += size;
+  *buf_size -= size;
+  return b;
+}
+
+/* Initializes pool P as owning the CNT pages starting at page
+   index START and allowed to grow to MAX_PAGES, naming it NAME
+   for debugging purposes. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
+init_pool (struct pool *p, const char *name, size_t start, size_t cnt,
+           size_t max_pages) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
-
-  printf ("%zu pages available in %s.\n", page_cnt, name);
-
-  /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  printf ("%zu pages available in %s.\n", cnt, name);
+
+  p->name = name;
+  bitmap_set_all (p->used_map, true);
+  bitmap_set_multiple (p->used_map, start, cnt, false);
+  bitmap_set_multiple (user_owned, start, cnt, p == &user_pool);
+  p->page_cnt = cnt;
+  p->max_pages = max_pages;
+  p->reserve = cnt / 4;
+  p->min_pages = cnt / 2;
+  p->miss_cnt = p->borrow_cnt = p->return_cnt = p->fail_cnt = 0;
 }
 
-/* Returns true if PAGE was allocated from POOL,
-   false otherwise. */
+/* Moves a chunk of free pages from the pool other than P into P,
+   preferring one that P started with.  Returns true if
+   successful, false if the other pool has no whole free chunk to
+   spare or P may not grow.  PALLOC_LOCK must be held. */
 static bool
-page_from_pool (const struct pool *pool, void *page) 
+borrow_chunk (struct pool *p) 
+{
+  struct pool *lender = p == &user_pool ? &kernel_pool : &user_pool;
+  size_t chunk;
+
+  ASSERT (lock_held_by_current_thread (&palloc_lock));
+
+  if (p->max_pages - p->page_cnt < CHUNK_PAGES)
+    return false;
+
+  /* Take back one of P's own chunks, which the lender must give
+     up regardless of its reserve. */
+  for (chunk = 0; chunk + CHUNK_PAGES <= page_cnt; chunk += CHUNK_PAGES)
+    if (home_pool (chunk) == p
+        && bitmap_none (lender->used_map, chunk, CHUNK_PAGES))
+      {
+        move_chunk (lender, p, chunk);
+        lender->return_cnt++;
+        return true;
+      }
+
+  /* Otherwise borrow one of the lender's own, if it can spare
+     it. */
+  if (lender->page_cnt < lender->min_pages + CHUNK_PAGES
+      || (bitmap_count (lender->used_map, 0, page_cnt, false)
+          < lender->reserve + CHUNK_PAGES))
+    return false;
+  for (chunk = 0; chunk + CHUNK_PAGES <= page_cnt; chunk += CHUNK_PAGES)
+    if (bitmap_none (lender->used_map, chunk, CHUNK_PAGES))
+      {
+        move_chunk (lender, p, chunk);
+        p->borrow_cnt++;
+        return true;
+      }
+  return false;
+}
+
+/* Returns the pool that owned page PAGE_IDX at startup. */
+static struct pool *
+home_pool (size_t page_idx) 
+{
+  return page_idx < user_start ? &kernel_pool : &user_pool;
+}
+
+/* Moves the free chunk of pages starting at page index CHUNK from
+   pool FROM, which owns it, to pool TO.  PALLOC_LOCK must be
+   held. */
+static void
+move_chunk (struct pool *from, struct pool *to, size_t chunk) 
 {
-  size_t page_no = pg_no (page);
-  size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  ASSERT (lock_held_by_current_thread (&palloc_lock));
+  ASSERT (bitmap_none (from->used_map, chunk, CHUNK_PAGES));
 
-  return page_no >= start_page && page_no < end_page;
+  bitmap_set_multiple (from->used_map, chunk, CHUNK_PAGES, true);
+  bitmap_set_multiple (user_owned, chunk, CHUNK_PAGES, to == &user_pool);
+  bitmap_set_multiple (to->used_map, chunk, CHUNK_PAGES, false);
+  from->page_cnt -= CHUNK_PAGES;
+  to->page_cnt += CHUNK_PAGES;
 }
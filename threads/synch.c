@@ -336,3 +336,64 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes wait queue Q. */
+void
+waitq_init (struct waitq *q)
+{
+  ASSERT (q != NULL);
+
+  list_init (&q->waiters);
+}
+
+/* Registers ENTRY on wait queue Q, so that SEMA is upped each
+   time Q is woken until waitq_remove(ENTRY) is called.
+
+   To wait for a condition without missing a wakeup, register
+   first, then test the condition, and only then down SEMA. */
+void
+waitq_add (struct waitq *q, struct waitq_entry *entry, struct semaphore *sema)
+{
+  enum intr_level old_level;
+
+  ASSERT (q != NULL);
+  ASSERT (entry != NULL);
+  ASSERT (sema != NULL);
+
+  entry->sema = sema;
+  old_level = intr_disable ();
+  list_push_back (&q->waiters, &entry->elem);
+  intr_set_level (old_level);
+}
+
+/* Removes ENTRY from the wait queue it was added to. */
+void
+waitq_remove (struct waitq_entry *entry)
+{
+  enum intr_level old_level;
+
+  ASSERT (entry != NULL);
+
+  old_level = intr_disable ();
+  list_remove (&entry->elem);
+  intr_set_level (old_level);
+}
+
+/* Ups the semaphore of every entry on wait queue Q.  The
+   entries stay registered.
+
+   This function may be called from an interrupt handler. */
+void
+waitq_wake (struct waitq *q)
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+
+  ASSERT (q != NULL);
+
+  old_level = intr_disable ();
+  for (e = list_begin (&q->waiters); e != list_end (&q->waiters);
+       e = list_next (e))
+    sema_up (list_entry (e, struct waitq_entry, elem)->sema);
+  intr_set_level (old_level);
+}
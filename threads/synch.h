@@ -41,6 +41,27 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Wait queue.  Unlike a condition variable, it has no lock, so
+   it may be woken from an interrupt handler. */
+struct waitq
+  {
+    struct list waiters;        /* List of waitq_entry. */
+  };
+
+/* A thread's registration on a wait queue.  One thread may
+   register on several queues with the same semaphore, to wait
+   for whichever is woken first. */
+struct waitq_entry
+  {
+    struct list_elem elem;      /* Element in waitq's list. */
+    struct semaphore *sema;     /* Upped on every wakeup. */
+  };
+
+void waitq_init (struct waitq *);
+void waitq_add (struct waitq *, struct waitq_entry *, struct semaphore *);
+void waitq_remove (struct waitq_entry *);
+void waitq_wake (struct waitq *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
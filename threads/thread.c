@@ -99,12 +99,6 @@ thread_init (void)
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
-
-#ifdef USERPROG
-  list_init (&initial_thread->cs_list);
-  lock_init (&initial_thread->cs_lock);
-#endif
-
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -136,7 +130,10 @@ thread_tick (void)
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
-    user_ticks++;
+    {
+      user_ticks++;
+      t->usage.ticks++;
+    }
 #endif
   else
     kernel_ticks++;
@@ -204,37 +201,29 @@ thread_create (const char *name, int priority,
   sf = alloc_frame (t, sizeof *sf);
   sf->eip = switch_entry;
 
-  enum intr_level old_level = intr_disable ();
-  list_push_back (&threads_list, &t->t_elem);
-  intr_set_level (old_level);
-
   #ifdef USERPROG
     t->fd_bitmap = bitmap_create (FD_SIZE);
     if (t->fd_bitmap == NULL)
       PANIC("FD bitmap is too big! :s");
 
-    /* Allocate and initilize a child status. */
-    struct child_status *cs = (struct child_status *)malloc(sizeof(struct child_status));
-    cs->pid = tid;
-    cs->ref_cnt = 2;
-    cs->exit_status = -1;
-    lock_init(&cs->l);
-    sema_init(&cs->sema_wait, 0);
-
-    /* Initilize child status for child. */
-    list_init(&t->cs_list);
-    t->cs = cs;
     t->exit_status = 0;            /* Init exit status to ok (0). */
     sema_init (&t->sema_exec, 0);
-    lock_init(&t->cs_lock);
-  
-    /* Update parent with new child status. */
-    struct thread *parent = thread_current();
-    lock_acquire(&parent->cs_lock);
-    list_push_back(&parent->cs_list, &cs->cs_elem);
-    lock_release(&parent->cs_lock);
+    if (!process_add_child (t))
+      {
+        bitmap_destroy (t->fd_bitmap);
+        palloc_free_page (t);
+        return TID_ERROR;
+      }
   #endif
 
+  enum intr_level old_level = intr_disable ();
+  list_push_back (&threads_list, &t->t_elem);
+  intr_set_level (old_level);
+#ifdef VM
+  /* Child processes inherit the resident page limit. */
+  t->rss_limit = thread_current ()->rss_limit;
+#endif
+
   /* Add to run queue. */
   thread_unblock (t);
 
@@ -507,6 +496,10 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
+#ifdef USERPROG
+  list_init (&t->aio_requests);
+  list_init (&t->shm_attachments);
+#endif
   t->magic = THREAD_MAGIC;
 }
 
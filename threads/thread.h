@@ -2,8 +2,10 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include <syscall-nr.h>
 #include "lib/kernel/bitmap.h"
 #include "threads/synch.h"
 
@@ -104,30 +106,61 @@ struct thread
     struct semaphore sema_exec; /* Sleep and wake thread. */
     bool load_success;         /* Did process load successfully. */
     struct child_status *cs;    /* Child status to use with parent for exit code. */
-    struct list cs_list;        /* List of child statuses. */
-    struct lock cs_lock;        /* Lock for accessing cs_list. */
+    struct hash children;       /* Statuses of children, by pid. */
+    struct list zombies;        /* Exited children not yet waited for. */
+    struct condition child_exit; /* Signaled when a child exits. */
+    struct rusage usage;        /* Resources used; PEAK before memlimit(). */
+    struct rusage child_usage;  /* Resources used by reaped children. */
 
     #define FD_SIZE 128
     struct bitmap * fd_bitmap;    /* Bitmap of open file discriptors. */
     struct file* files[FD_SIZE];  /* Pointers to opened files. */ 
+    struct file *exec_file;     /* Running executable, denied writes. */
+
+    /* Owned by userprog/syscall.c. */
+    struct ring *ring;          /* Kernel address of ring, or null. */
+
+    /* Owned by userprog/aio.c. */
+    struct list aio_requests;   /* Outstanding asynchronous I/O. */
+    int next_aio_id;            /* Identifier for the next request. */
+
+    /* Owned by userprog/shm.c. */
+    struct list shm_attachments; /* Attached shared memory segments. */
+#endif
+
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash pages;          /* Supplemental page table. */
+    void *user_esp;             /* User stack pointer at syscall entry. */
+
+    /* Owned by vm/mmap.c. */
+    struct list mappings;       /* Memory-mapped files. */
+    int next_mapid;             /* Identifier for the next mapping. */
+
+    /* Owned by vm/frame.c. */
+    int rss;                    /* Number of pages in frames. */
+    int rss_peak;               /* Maximum of RSS so far. */
+    int rss_limit;              /* Limit on RSS, 0 if none. */
 #endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
 
-/* Child status list item.*/
+/* Status of a child process, kept by its parent until the
+   parent waits for it or exits.  Owned by userprog/process.c,
+   protected by its wait_lock. */
 struct child_status
   {
     int pid;
-    int ref_cnt;
-    int exit_status;
-    
-    struct semaphore sema_wait; /* Sleep and wake process wait. */
-    struct lock l; // Lock for modifying child status.
+    int exit_status;            /* Exit code, once EXITED. */
+    bool exited;                /* Has the child exited? */
+    struct rusage usage;        /* Total usage, once EXITED. */
+    struct thread *parent;      /* Parent, or null after it exits. */
 
-    struct list_elem cs_elem;
-  }; 
+    struct hash_elem hash_elem; /* Element in parent's children. */
+    struct list_elem zombie_elem; /* Element in parent's zombies. */
+  };
 
 
 /* Sleeper list item. */
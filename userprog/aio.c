@@ -0,0 +1,193 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Asynchronous file I/O.
+
+   A process submits a read or write with aio_submit(), which
+   queues it and returns at once.  A pool of AIO_WORKER_CNT kernel
+   threads takes requests off the queue and carries them out, so
+   that the process can compute while its I/O is in progress, and
+   several of its requests can be in progress at once.  The
+   process collects the result with aio_complete(), waiting if
+   need be.
+
+   Workers do not run in the process's address space, so every
+   request transfers data to or from a kernel buffer; copying
+   between that and user memory is up to the caller. */
+
+/* Number of worker threads. */
+#define AIO_WORKER_CNT 4
+
+/* An asynchronous I/O request. */
+struct aio_request
+  {
+    struct list_elem queue_elem; /* Element in aio_queue. */
+    struct list_elem proc_elem; /* Element in owner's aio_requests. */
+    int id;                     /* Identifier, unique in the process. */
+
+    struct file *file;          /* File, shared with the process. */
+    bool write;                 /* True to write, false to read. */
+    void *buf;                  /* Kernel buffer. */
+    size_t size;                /* Bytes to transfer. */
+    off_t ofs;                  /* Offset in FILE. */
+    void *aux;                  /* For the caller's use. */
+
+    int result;                 /* Bytes transferred. */
+    struct semaphore done;      /* Upped when RESULT is set. */
+  };
+
+/* Requests not yet taken by a worker. */
+static struct list aio_queue;
+static struct lock aio_lock;    /* Protects aio_queue. */
+static struct condition aio_queued; /* Signaled when a request is queued. */
+
+static thread_func aio_worker NO_RETURN;
+static struct aio_request *find_request (int id);
+
+/* Initializes asynchronous I/O and starts the worker threads. */
+void
+aio_init (void) 
+{
+  int i;
+
+  list_init (&aio_queue);
+  lock_init (&aio_lock);
+  cond_init (&aio_queued);
+  for (i = 0; i < AIO_WORKER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "aio%d", i);
+      thread_create (name, PRI_DEFAULT, aio_worker, NULL);
+    }
+}
+
+/* Queues a request to transfer SIZE bytes between FILE, at offset
+   OFS, and kernel buffer BUF: from FILE into BUF if WRITE is
+   false, from BUF into FILE otherwise.  BUF must have been
+   obtained from malloc(); it belongs to the request until it is
+   handed back by aio_complete(), along with AUX.  FILE's position
+   is not used, and FILE stays open until the request completes.
+   Returns the request's identifier, or -1 if the current process
+   has too many requests outstanding or memory is short. */
+int
+aio_submit (struct file *file, bool write, void *buf, size_t size, off_t ofs,
+            void *aux) 
+{
+  struct thread *t = thread_current ();
+  struct aio_request *r;
+
+  ASSERT (size <= AIO_MAX_SIZE);
+
+  if (list_size (&t->aio_requests) >= AIO_MAX_REQUESTS)
+    return -1;
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return -1;
+
+  r->id = t->next_aio_id++;
+  r->file = file_dup (file);
+  r->write = write;
+  r->buf = buf;
+  r->size = size;
+  r->ofs = ofs;
+  r->aux = aux;
+  r->result = -1;
+  sema_init (&r->done, 0);
+  list_push_back (&t->aio_requests, &r->proc_elem);
+
+  lock_acquire (&aio_lock);
+  list_push_back (&aio_queue, &r->queue_elem);
+  cond_signal (&aio_queued, &aio_lock);
+  lock_release (&aio_lock);
+
+  return r->id;
+}
+
+/* Waits for the current process's request ID to complete and
+   stores the number of bytes it transferred, or -1 if it failed,
+   into *RESULT, its buffer into *BUF and its AUX into *AUX.  The
+   caller must free *BUF.  Returns false, storing nothing, if
+   there is no such request, as when it has already been
+   completed. */
+bool
+aio_complete (int id, int *result, void **buf, void **aux) 
+{
+  struct aio_request *r = find_request (id);
+
+  if (r == NULL)
+    return false;
+
+  sema_down (&r->done);
+  list_remove (&r->proc_elem);
+  file_close (r->file);
+  *result = r->result;
+  *buf = r->buf;
+  *aux = r->aux;
+  free (r);
+  return true;
+}
+
+/* Waits for all of the current process's outstanding requests
+   and frees them.  Called at process exit. */
+void
+aio_exit (void) 
+{
+  struct list *requests = &thread_current ()->aio_requests;
+
+  while (!list_empty (requests))
+    {
+      struct aio_request *r = list_entry (list_front (requests),
+                                          struct aio_request, proc_elem);
+      void *buf, *aux;
+      int result;
+      aio_complete (r->id, &result, &buf, &aux);
+      free (buf);
+    }
+}
+
+/* Returns the current process's request ID, or a null pointer if
+   there is none. */
+static struct aio_request *
+find_request (int id) 
+{
+  struct list *requests = &thread_current ()->aio_requests;
+  struct list_elem *e;
+
+  for (e = list_begin (requests); e != list_end (requests); e = list_next (e))
+    {
+      struct aio_request *r = list_entry (e, struct aio_request, proc_elem);
+      if (r->id == id)
+        return r;
+    }
+  return NULL;
+}
+
+/* Worker thread, which carries out queued requests one at a
+   time, forever. */
+static void
+aio_worker (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      struct aio_request *r;
+
+      lock_acquire (&aio_lock);
+      while (list_empty (&aio_queue))
+        cond_wait (&aio_queued, &aio_lock);
+      r = list_entry (list_pop_front (&aio_queue),
+                      struct aio_request, queue_elem);
+      lock_release (&aio_lock);
+
+      if (r->write)
+        r->result = file_write_at (r->file, r->buf, r->size, r->ofs);
+      else
+        r->result = file_read_at (r->file, r->buf, r->size, r->ofs);
+      sema_up (&r->done);
+    }
+}
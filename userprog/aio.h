@@ -0,0 +1,22 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct file;
+
+/* Largest transfer a single request may make, in bytes. */
+#define AIO_MAX_SIZE (64 * 1024)
+
+/* Most requests a process may have outstanding at once. */
+#define AIO_MAX_REQUESTS 16
+
+void aio_init (void);
+int aio_submit (struct file *, bool write, void *buf, size_t size, off_t ofs,
+                void *aux);
+bool aio_complete (int id, int *result, void **buf, void **aux);
+void aio_exit (void);
+
+#endif /* userprog/aio.h */
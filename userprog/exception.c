@@ -2,13 +2,18 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void debug (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -43,7 +48,7 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -108,6 +113,27 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Debug exception handler.
+
+   SYSENTER, unlike an interrupt gate, does not clear the trap
+   flag, so a user program that sets it and then executes SYSENTER
+   takes a single-step exception in the kernel, on the first
+   instructions of sysenter_entry, possibly while still on the
+   small SYSENTER stack (see userprog/tss.c).  That is the only
+   way the kernel can run with the trap flag set, so we clear it
+   and resume, as Linux does.  The process loses its single-step
+   trap, which we do not support anyway. */
+static void
+debug (struct intr_frame *f)
+{
+  if (f->cs == SEL_KCSEG && (f->eflags & FLAG_TF) != 0)
+    {
+      f->eflags &= ~FLAG_TF;
+      return;
+    }
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -142,12 +168,27 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+  thread_current ()->usage.page_faults++;
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Bring in the page if it belongs to the process.  A fault
+     taken in the kernel on behalf of a system call uses the user
+     stack pointer saved at syscall entry. */
+  if (not_present
+      && page_fault_in (fault_addr,
+                        user ? f->esp : thread_current ()->user_esp))
+    return;
+
+  /* Copy a page shared with a forked process on first write. */
+  if (!not_present && write && page_fault_cow (fault_addr))
+    return;
+#endif
+
   /* User accesing unallowed */
   f->eip = f->eax;
   f->eax = 0xffffffff;
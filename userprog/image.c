@@ -0,0 +1,329 @@
+#include "userprog/image.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Executable image cache.
+
+   load() in userprog/process.c parses and validates an
+   executable's ELF and program headers into a `struct image'.
+   The image is kept here, keyed by the executable's inode, so
+   that loading the same executable again skips straight to
+   loading its segments.  Up to IMAGE_CACHE_PAGES pages of the
+   read-only segments are also kept, in kernel pages, so that
+   they need not be read from disk again either.  (While some
+   process is running the executable, vm/frame.c shares its
+   read-only frames anyway; this cache is what helps when a
+   program is run again and again, one process after another.)
+
+   Each image keeps its inode open, so that the inode's version
+   (see inode_get_version()) tells whether the file has been
+   written since it was parsed.  A stale image, or one whose file
+   has been removed, is dropped the next time the cache is
+   searched.  Images are evicted least recently used first, when
+   there are more than IMAGE_CACHE_MAX of them or their pages
+   exceed the budget.  An image that a load is still using is
+   freed only when the load releases it. */
+
+/* Maximum number of cached images. */
+#define IMAGE_CACHE_MAX 16
+
+/* Maximum number of cached segment pages, in all images. */
+#define IMAGE_CACHE_PAGES 64
+
+static struct list lru;         /* Cached images, most recent first. */
+static struct lock image_lock;  /* Protects everything in this file. */
+static size_t cached_pages;     /* Pages held by images. */
+
+/* Statistics. */
+static long long hit_cnt;               /* Lookups that found an image. */
+static long long miss_cnt;              /* Lookups that did not. */
+static long long stale_cnt;             /* Images dropped as stale. */
+static long long evict_cnt;             /* Images evicted. */
+static long long page_hit_cnt;          /* Pages found in the cache. */
+static long long hit_cycles;            /* Cycles loading with a hit. */
+static long long miss_cycles;           /* Cycles loading with a miss. */
+static long long hit_loads;             /* Loads with a hit. */
+static long long miss_loads;            /* Loads with a miss. */
+
+static void uncache (struct image *);
+static void destroy (struct image *);
+static bool evict (const struct image *keep);
+
+/* Initializes the image cache. */
+void
+image_init (void)
+{
+  list_init (&lru);
+  lock_init (&image_lock);
+}
+
+/* Returns the cached image of the executable in INODE, which the
+   caller must release with image_release(), or a null pointer if
+   there is none or it is out of date. */
+struct image *
+image_lookup (struct inode *inode)
+{
+  struct image *found = NULL;
+  struct list_elem *e, *next;
+
+  lock_acquire (&image_lock);
+  for (e = list_begin (&lru); e != list_end (&lru); e = next)
+    {
+      struct image *img = list_entry (e, struct image, elem);
+      next = list_next (e);
+
+      if (inode_is_removed (img->inode)
+          || (img->inode == inode
+              && (found != NULL
+                  || img->version != inode_get_version (inode))))
+        {
+          uncache (img);
+          stale_cnt++;
+        }
+      else if (img->inode == inode)
+        found = img;
+    }
+
+  if (found != NULL)
+    {
+      list_remove (&found->elem);
+      list_push_front (&lru, &found->elem);
+      found->ref_cnt++;
+      hit_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&image_lock);
+
+  return found;
+}
+
+/* Creates and caches an image of the executable in INODE, with
+   entry point ENTRY and the SEGMENT_CNT segments in SEGMENTS, and
+   returns it.  The caller must release it with image_release().
+   Returns a null pointer if memory is short. */
+struct image *
+image_create (struct inode *inode, void (*entry) (void),
+              const struct image_segment *segments, int segment_cnt)
+{
+  struct image *img;
+  int i;
+
+  img = malloc (sizeof *img);
+  if (img == NULL)
+    return NULL;
+  img->segments = calloc (segment_cnt, sizeof *img->segments);
+  if (img->segments == NULL && segment_cnt > 0)
+    {
+      free (img);
+      return NULL;
+    }
+  img->inode = inode_reopen (inode);
+  img->version = inode_get_version (inode);
+  img->ref_cnt = 1;
+  img->cached = false;
+  img->page_cnt = 0;
+  img->entry = entry;
+  img->segment_cnt = segment_cnt;
+
+  for (i = 0; i < segment_cnt; i++)
+    {
+      struct image_segment *seg = &img->segments[i];
+
+      *seg = segments[i];
+      seg->pages = NULL;
+      if (!seg->writable && seg->read_bytes > 0)
+        {
+          seg->pages = calloc (DIV_ROUND_UP (seg->read_bytes, PGSIZE),
+                               sizeof *seg->pages);
+          if (seg->pages == NULL)
+            {
+              destroy (img);
+              return NULL;
+            }
+        }
+    }
+
+  lock_acquire (&image_lock);
+  while (list_size (&lru) >= IMAGE_CACHE_MAX && evict (NULL))
+    continue;
+  if (list_size (&lru) < IMAGE_CACHE_MAX)
+    {
+      list_push_front (&lru, &img->elem);
+      img->cached = true;
+    }
+  lock_release (&image_lock);
+
+  return img;
+}
+
+/* Releases IMG, obtained from image_lookup() or image_create(). */
+void
+image_release (struct image *img)
+{
+  lock_acquire (&image_lock);
+  if (--img->ref_cnt == 0 && !img->cached)
+    destroy (img);
+  lock_release (&image_lock);
+}
+
+/* Returns the cached contents of page PAGE of read-only segment
+   SEGMENT of IMG, or a null pointer if they are not cached.  The
+   contents stay valid until IMG is released. */
+const void *
+image_get_page (struct image *img, int segment, size_t page)
+{
+  const struct image_segment *seg = &img->segments[segment];
+  void *kpage;
+
+  ASSERT (segment < img->segment_cnt);
+  ASSERT (page < DIV_ROUND_UP (seg->read_bytes, PGSIZE)
+          || seg->pages == NULL);
+
+  if (seg->pages == NULL)
+    return NULL;
+
+  lock_acquire (&image_lock);
+  kpage = seg->pages[page];
+  if (kpage != NULL)
+    page_hit_cnt++;
+  lock_release (&image_lock);
+
+  return kpage;
+}
+
+/* Caches the SIZE bytes at DATA as the contents of page PAGE of
+   SEGMENT of IMG, if SEGMENT is read-only and they fit in the
+   budget, evicting older images to make room. */
+void
+image_put_page (struct image *img, int segment, size_t page,
+                const void *data, size_t size)
+{
+  struct image_segment *seg = &img->segments[segment];
+
+  ASSERT (segment < img->segment_cnt);
+  ASSERT (size <= PGSIZE);
+
+  if (seg->pages == NULL)
+    return;
+
+  lock_acquire (&image_lock);
+  if (img->cached && seg->pages[page] == NULL)
+    {
+      while (cached_pages >= IMAGE_CACHE_PAGES && evict (img))
+        continue;
+      if (cached_pages < IMAGE_CACHE_PAGES)
+        {
+          void *kpage = palloc_get_page (0);
+          if (kpage != NULL)
+            {
+              memcpy (kpage, data, size);
+              seg->pages[page] = kpage;
+              img->page_cnt++;
+              cached_pages++;
+            }
+        }
+    }
+  lock_release (&image_lock);
+}
+
+/* Records that a load took CYCLES CPU cycles, and whether it
+   found its image in the cache. */
+void
+image_note_load (bool hit, uint64_t cycles)
+{
+  lock_acquire (&image_lock);
+  if (hit)
+    {
+      hit_loads++;
+      hit_cycles += cycles;
+    }
+  else
+    {
+      miss_loads++;
+      miss_cycles += cycles;
+    }
+  lock_release (&image_lock);
+}
+
+/* Prints image cache statistics. */
+void
+image_print_stats (void)
+{
+  printf ("Image cache: %lld hits, %lld misses, %lld stale, "
+          "%lld evicted, %lld page hits\n",
+          hit_cnt, miss_cnt, stale_cnt, evict_cnt, page_hit_cnt);
+  if (hit_loads > 0)
+    printf ("Exec: %lld loads from cache, %lld cycles/load\n",
+            hit_loads, hit_cycles / hit_loads);
+  if (miss_loads > 0)
+    printf ("Exec: %lld loads from disk, %lld cycles/load\n",
+            miss_loads, miss_cycles / miss_loads);
+}
+
+/* Removes IMG from the cache, freeing it unless it is in use.
+   The caller must hold image_lock. */
+static void
+uncache (struct image *img)
+{
+  ASSERT (img->cached);
+
+  list_remove (&img->elem);
+  img->cached = false;
+  if (img->ref_cnt == 0)
+    destroy (img);
+}
+
+/* Frees IMG, its cached pages, and its hold on its inode.
+   The caller must hold image_lock, unless IMG was never
+   cached. */
+static void
+destroy (struct image *img)
+{
+  int i;
+
+  for (i = 0; i < img->segment_cnt; i++)
+    {
+      struct image_segment *seg = &img->segments[i];
+      if (seg->pages != NULL)
+        {
+          size_t j;
+          for (j = 0; j < DIV_ROUND_UP (seg->read_bytes, PGSIZE); j++)
+            if (seg->pages[j] != NULL)
+              palloc_free_page (seg->pages[j]);
+          free (seg->pages);
+        }
+    }
+  cached_pages -= img->page_cnt;
+  inode_close (img->inode);
+  free (img->segments);
+  free (img);
+}
+
+/* Evicts the least recently used image that is not in use and is
+   not KEEP.  Returns false if there is none.
+   The caller must hold image_lock. */
+static bool
+evict (const struct image *keep)
+{
+  struct list_elem *e;
+
+  for (e = list_rbegin (&lru); e != list_rend (&lru); e = list_prev (e))
+    {
+      struct image *img = list_entry (e, struct image, elem);
+      if (img != keep && img->ref_cnt == 0)
+        {
+          uncache (img);
+          evict_cnt++;
+          return true;
+        }
+    }
+  return false;
+}
@@ -0,0 +1,49 @@
+#ifndef USERPROG_IMAGE_H
+#define USERPROG_IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <list.h>
+#include "filesys/off_t.h"
+
+struct inode;
+
+/* A loadable segment of an executable, already validated. */
+struct image_segment
+  {
+    off_t ofs;                  /* Page-aligned offset in file. */
+    uint8_t *upage;             /* User address of first page. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;              /* Writable by the user? */
+    void **pages;               /* Cached contents, by page, or null. */
+  };
+
+/* The parsed layout of an executable, cached by inode. */
+struct image
+  {
+    struct list_elem elem;      /* Element in LRU list. */
+    struct inode *inode;        /* Executable, kept open. */
+    unsigned version;           /* INODE's version when parsed. */
+    int ref_cnt;                /* Number of loads using the image. */
+    bool cached;                /* In the LRU list? */
+    size_t page_cnt;            /* Number of cached pages. */
+
+    void (*entry) (void);       /* Entry point. */
+    int segment_cnt;            /* Number of segments. */
+    struct image_segment *segments; /* Loadable segments. */
+  };
+
+void image_init (void);
+struct image *image_lookup (struct inode *);
+struct image *image_create (struct inode *, void (*entry) (void),
+                            const struct image_segment *, int segment_cnt);
+void image_release (struct image *);
+const void *image_get_page (struct image *, int segment, size_t page);
+void image_put_page (struct image *, int segment, size_t page,
+                     const void *data, size_t size);
+void image_note_load (bool hit, uint64_t cycles);
+void image_print_stats (void);
+
+#endif /* userprog/image.h */
@@ -0,0 +1,31 @@
+#ifndef USERPROG_LAYOUT_H
+#define USERPROG_LAYOUT_H
+
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* Fixed areas at the top of a user address space, from PHYS_BASE
+   down.  They do not overlap:
+
+     - STACK_MAX bytes that only the stack may grow into
+       (see vm/page.c).
+
+     - One page for the process's system call ring, if it has one
+       (see ring_setup() in userprog/syscall.c).
+
+     - SHM_AREA_SIZE bytes in which shared memory segments are
+       attached (see userprog/shm.c). */
+
+/* Maximum size of a process's stack, in bytes. */
+#define STACK_MAX (8 * 1024 * 1024)
+#define STACK_BOTTOM ((uint8_t *) PHYS_BASE - STACK_MAX)
+
+/* User address of the page that holds a process's ring. */
+#define RING_UPAGE ((void *) (STACK_BOTTOM - PGSIZE))
+
+/* User address range in which segments are attached. */
+#define SHM_AREA_SIZE (16 * 1024 * 1024)
+#define SHM_TOP ((uint8_t *) RING_UPAGE)
+#define SHM_BASE (SHM_TOP - SHM_AREA_SIZE)
+
+#endif /* userprog/layout.h */
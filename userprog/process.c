@@ -1,12 +1,17 @@
 #include "userprog/process.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <rdtsc.h>
 #include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <syscall-nr.h>
+#include "userprog/aio.h"
 #include "userprog/gdt.h"
+#include "userprog/image.h"
 #include "userprog/pagedir.h"
+#include "userprog/shm.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -14,73 +19,194 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "lib/kernel/list.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
-static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+#ifdef VM
+bool process_report_memory;
+#endif
+bool process_report_usage;
 
-/* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
+/* Protects every process's children, zombies and child_exit,
+   and the child statuses in them. */
+static struct lock wait_lock;
+
+static thread_func start_process NO_RETURN;
+static bool load (const struct exec_args *, void (**eip) (void), void **esp);
+static bool create_address_space (void);
+static bool init_children (struct thread *);
+static struct child_status *find_child (struct thread *, tid_t);
+static hash_hash_func child_hash;
+static hash_less_func child_less;
+static hash_action_func orphan_child;
+static void exit_children (void);
+static void get_own_rusage (struct thread *, struct rusage *);
+static void add_rusage (struct rusage *, const struct rusage *);
+
+/* Starts a new thread running a user program loaded from the
+   command line CMD_LINE, split into words at spaces, of which the
+   first names the program.  Words past the EXEC_ARGS_MAX'th are
+   ignored.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   thread id, or TID_ERROR if the thread cannot be created or the
+   program cannot be loaded. */
 tid_t
-process_execute (const char *file_name) 
+process_execute (const char *cmd_line) 
 {
-  char *fn_copy, *fn_copy2;
-  char *save_ptr;
-  tid_t tid;
-  
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
-    return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  struct exec_args *args;
+  const char *word = cmd_line;
 
-  fn_copy2 = palloc_get_page (0);
-  if (fn_copy2 == NULL)
+  args = exec_args_create ();
+  if (args == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy2, file_name, PGSIZE);
+  for (;;)
+    {
+      size_t len;
+
+      while (*word == ' ')
+        word++;
+      if (*word == '\0')
+        break;
+      len = strcspn (word, " ");
+      if (args->argc == 0)
+        {
+          /* The first word names the program.  A longer one cannot
+             be the name of any file. */
+          if (len >= sizeof args->file_name)
+            {
+              palloc_free_page (args);
+              return TID_ERROR;
+            }
+          memcpy (args->file_name, word, len);
+          args->file_name[len] = '\0';
+        }
+      if (!exec_args_push (args, word, len))
+        break;
+      word += len;
+    }
+  if (args->argc == 0)
+    {
+      palloc_free_page (args);
+      return TID_ERROR;
+    }
+  return process_spawn (args, true);
+}
+
+/* Allocates an empty argument block for process_spawn(), in a
+   page of its own.  Returns a null pointer if memory is short. */
+struct exec_args *
+exec_args_create (void)
+{
+  struct exec_args *args = palloc_get_page (0);
+  if (args != NULL)
+    {
+      args->file_name[0] = '\0';
+      args->argc = 0;
+      args->size = 0;
+      memset (args->pipes, 0, sizeof args->pipes);
+    }
+  return args;
+}
 
-  fn_copy2 = strtok_r(fn_copy2, " ", &save_ptr);
+/* Appends the LEN bytes at ARG, plus a null terminator, to ARGS
+   as its next argument.  Returns false if ARGS is full. */
+bool
+exec_args_push (struct exec_args *args, const char *arg, size_t len)
+{
+  if (args->argc == EXEC_ARGS_MAX
+      || len >= sizeof args->strings - args->size)
+    return false;
+  memcpy (args->strings + args->size, arg, len);
+  args->strings[args->size + len] = '\0';
+  args->size += len + 1;
+  args->argc++;
+  return true;
+}
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (fn_copy2, PRI_DEFAULT, start_process, fn_copy);
+/* Starts a new thread running the user program ARGS->file_name
+   with the arguments in ARGS, of which it takes ownership.  The
+   new process inherits each of the current process's file
+   descriptors that refers to a pipe, at the same number; other
+   file descriptors are not inherited across exec in Pintos.
+
+   If WAIT_LOAD is true, waits for the program to load and returns
+   TID_ERROR if it cannot be.  Otherwise, returns at once, and a
+   program that fails to load exits with status -1.  Returns the
+   new process's thread id, or TID_ERROR if the thread cannot be
+   created. */
+tid_t
+process_spawn (struct exec_args *args, bool wait_load)
+{
+  struct thread *cur = thread_current ();
+  struct thread *child;
+  tid_t tid;
+  size_t fd;
+
+  /* The initial thread has no file descriptors. */
+  if (cur->fd_bitmap != NULL)
+    for (fd = 0; fd < FD_SIZE; fd++)
+      if (bitmap_test (cur->fd_bitmap, fd) && file_is_pipe (cur->files[fd]))
+        args->pipes[fd] = file_dup (cur->files[fd]);
+
+  tid = thread_create (args->file_name, PRI_DEFAULT, start_process, args);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+    {
+      for (fd = 0; fd < FD_SIZE; fd++)
+        file_close (args->pipes[fd]);
+      palloc_free_page (args);
+      return TID_ERROR;
+    }
+  if (!wait_load)
+    return tid;
 
   /* Wait for child to load. */
-  struct thread *child = get_thread (tid);
-  sema_down(&child->sema_exec);
+  child = get_thread (tid);
+  sema_down (&child->sema_exec);
 
   /* Check if child didn't load successfully. */
-  if(!child->load_success)
-    return -1;
+  if (!child->load_success)
+    return TID_ERROR;
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *args_)
 {
-  char *file_name = file_name_;
+  struct exec_args *args = args_;
+  struct thread *t = thread_current ();
   struct intr_frame if_;
   bool success;
+  size_t fd;
+
+  /* Install inherited file descriptors first, so that they are
+     closed if loading fails. */
+  for (fd = 0; fd < FD_SIZE; fd++)
+    if (args->pipes[fd] != NULL)
+      {
+        t->files[fd] = args->pipes[fd];
+        bitmap_mark (t->fd_bitmap, fd);
+      }
 
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (args, &if_.eip, &if_.esp);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
+  palloc_free_page (args);
   thread_current ()->load_success = success;
   sema_up(&thread_current ()->sema_exec);
   thread_yield ();
@@ -99,54 +225,320 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/* Passed from process_fork() to fork_process(). */
+struct fork_info
+  {
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame *if_;     /* Parent's user context. */
+    struct semaphore done;      /* Upped once the child is set up. */
+    bool success;               /* Was the child set up? */
+  };
+
+static thread_func fork_process NO_RETURN;
+
+/* Starts a new process that is a copy of the current one, which
+   entered the kernel with user context IF_.  The child's memory
+   is shared copy-on-write and it inherits the open files, with
+   shared file positions.  The child returns 0 from the system
+   call.  Returns the child's thread id, or TID_ERROR if the child
+   cannot be created. */
+tid_t
+process_fork (struct intr_frame *if_)
+{
+  struct fork_info fi;
+  tid_t tid;
+
+  fi.parent = thread_current ();
+  fi.if_ = if_;
+  sema_init (&fi.done, 0);
+
+  tid = thread_create (fi.parent->name, PRI_DEFAULT, fork_process, &fi);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* Wait for the child to copy our address space. */
+  sema_down (&fi.done);
+  return fi.success ? tid : TID_ERROR;
+}
+
+/* A thread function that copies its parent's address space and
+   open files and then resumes the parent's user context. */
+static void
+fork_process (void *fi_)
+{
+  struct fork_info *fi = fi_;
+  struct thread *t = thread_current ();
+  struct thread *parent = fi->parent;
+  struct intr_frame if_;
+  bool success;
+  size_t fd;
+
+  memcpy (&if_, fi->if_, sizeof if_);
+  if_.eax = 0;
+
+  t->exec_file = file_reopen (parent->exec_file);
+  if (t->exec_file != NULL)
+    file_deny_write (t->exec_file);
+
+  success = (t->exec_file != NULL
+             && create_address_space () && page_table_copy (parent));
+  if (success)
+    for (fd = 0; fd < FD_SIZE; fd++)
+      if (bitmap_test (parent->fd_bitmap, fd))
+        {
+          t->files[fd] = file_dup (parent->files[fd]);
+          bitmap_mark (t->fd_bitmap, fd);
+        }
+
+  /* FI lives on the parent's stack, so it is gone once the parent
+     wakes up. */
+  t->load_success = success;
+  fi->success = success;
+  sema_up (&fi->done);
+
+  if (!success) 
+    thread_exit ();
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+#endif
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
+{
+  int status;
+
+  if (child_tid == TID_ERROR)
+    return -1;
+  return process_waitpid (child_tid, &status, 0) != TID_ERROR ? status : -1;
+}
+
+/* Waits for child CHILD_TID of the current process, or for any
+   child if CHILD_TID is -1, to exit, stores its exit status in
+   *STATUS, forgets about it and returns its tid.  Children that
+   have already exited are reaped in the order in which they
+   exited.  With WNOHANG in OPTIONS, returns 0 at once instead of
+   waiting if no such child has exited yet.  Returns TID_ERROR if
+   there is no such child. */
+tid_t
+process_waitpid (tid_t child_tid, int *status, int options)
+{
+  struct thread *t = thread_current ();
+  struct child_status *cs = NULL;
+  tid_t tid = TID_ERROR;
+
+  lock_acquire (&wait_lock);
+  for (;;)
+    {
+      if (child_tid == -1)
+        {
+          if (hash_empty (&t->children))
+            break;
+          if (!list_empty (&t->zombies))
+            cs = list_entry (list_front (&t->zombies),
+                             struct child_status, zombie_elem);
+        }
+      else
+        {
+          cs = find_child (t, child_tid);
+          if (cs == NULL)
+            break;
+          if (!cs->exited)
+            cs = NULL;
+        }
+
+      if (cs != NULL)
+        {
+          hash_delete (&t->children, &cs->hash_elem);
+          list_remove (&cs->zombie_elem);
+          add_rusage (&t->child_usage, &cs->usage);
+          *status = cs->exit_status;
+          tid = cs->pid;
+          free (cs);
+          break;
+        }
+      if (options & WNOHANG)
+        {
+          tid = 0;
+          break;
+        }
+      cond_wait (&t->child_exit, &wait_lock);
+    }
+  lock_release (&wait_lock);
+
+  return tid;
+}
+
+/* Sets up process bookkeeping.  Must be called before the first
+   thread_create(). */
+void
+process_init (void)
+{
+  lock_init (&wait_lock);
+  if (!init_children (thread_current ()))
+    PANIC ("out of memory for child process statuses");
+}
+
+/* Makes new thread T a child of the current thread, which
+   process_waitpid() can then wait for.  Returns false if memory
+   allocation fails. */
+bool
+process_add_child (struct thread *t)
 {
-  struct thread *parent = thread_current();
-  
-  /* Get child status for child with pid child_tid. */
-  bool found = false;
-  struct list_elem *e;
   struct child_status *cs;
-  struct list *cs_list = &parent->cs_list; 
-  lock_acquire(&parent->cs_lock);
-  for (e = list_begin (cs_list); 
-    e != list_end (cs_list) && !found;
-    e = list_next (e))
-  {
-    struct child_status *c = list_entry (e, struct child_status, cs_elem);
-    
-    if(c->pid == child_tid){
-      cs = c;
-      found = true;
-    } 
-  }
-  lock_release(&parent->cs_lock);
-  
-  /* Couldn't find child status with pid, bad pid.*/
-  if(!found) return -1;
 
-  lock_acquire(&parent->cs_lock);
-  list_remove(&cs->cs_elem);
-  lock_release(&parent->cs_lock);
+  if (!init_children (t))
+    return false;
+  cs = malloc (sizeof *cs);
+  if (cs == NULL)
+    {
+      hash_destroy (&t->children, NULL);
+      return false;
+    }
+  cs->pid = t->tid;
+  cs->exit_status = -1;
+  cs->exited = false;
+  cs->parent = thread_current ();
+  t->cs = cs;
+
+  lock_acquire (&wait_lock);
+  hash_insert (&cs->parent->children, &cs->hash_elem);
+  lock_release (&wait_lock);
+  return true;
+}
+
+/* Initializes T's index of children and queue of exited
+   children.  Returns false if memory allocation fails. */
+static bool
+init_children (struct thread *t)
+{
+  list_init (&t->zombies);
+  cond_init (&t->child_exit);
+  return hash_init (&t->children, child_hash, child_less, NULL);
+}
 
-  if(cs->ref_cnt != 1) {
-    sema_down(&cs->sema_wait);
-  }
-  
-  int exit_status = cs->exit_status;
-  free(cs);
-  
-  return exit_status;
+/* Returns the status of T's child TID, or a null pointer if
+   there is none.  The caller must hold wait_lock. */
+static struct child_status *
+find_child (struct thread *t, tid_t tid)
+{
+  struct child_status key;
+  struct hash_elem *e;
+
+  key.pid = tid;
+  e = hash_find (&t->children, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct child_status, hash_elem) : NULL;
+}
+
+/* Returns a hash value for child status E. */
+static unsigned
+child_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct child_status, hash_elem)->pid);
+}
+
+/* Returns true if child status A precedes child status B. */
+static bool
+child_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct child_status, hash_elem)->pid
+          < hash_entry (b, struct child_status, hash_elem)->pid);
+}
+
+/* Frees child status E of an exiting process if the child has
+   exited, or leaves it for the child to free otherwise.  The
+   caller must hold wait_lock. */
+static void
+orphan_child (struct hash_elem *e, void *aux UNUSED)
+{
+  struct child_status *cs = hash_entry (e, struct child_status, hash_elem);
+
+  if (cs->exited)
+    free (cs);
+  else
+    cs->parent = NULL;
+}
+
+/* Reports the current process's exit to its parent, and gives up
+   on its own children. */
+static void
+exit_children (void)
+{
+  struct thread *t = thread_current ();
+  struct child_status *cs = t->cs;
+
+  lock_acquire (&wait_lock);
+  if (cs != NULL)
+    {
+      if (cs->parent == NULL)
+        free (cs);
+      else
+        {
+          cs->exit_status = t->exit_status;
+          cs->exited = true;
+          get_own_rusage (t, &cs->usage);
+          add_rusage (&cs->usage, &t->child_usage);
+          list_push_back (&cs->parent->zombies, &cs->zombie_elem);
+          cond_signal (&cs->parent->child_exit, &wait_lock);
+        }
+      t->cs = NULL;
+    }
+  hash_destroy (&t->children, orphan_child);
+  lock_release (&wait_lock);
+}
+
+/* Stores the resource usage of the current process into *USAGE,
+   or if WHO is RUSAGE_CHILDREN, that of its children that it has
+   waited for. */
+void
+process_get_rusage (int who, struct rusage *usage)
+{
+  struct thread *t = thread_current ();
+
+  if (who == RUSAGE_CHILDREN)
+    {
+      lock_acquire (&wait_lock);
+      *usage = t->child_usage;
+      lock_release (&wait_lock);
+    }
+  else
+    get_own_rusage (t, usage);
+}
+
+/* Stores T's own resource usage, not counting its children, into
+   *USAGE. */
+static void
+get_own_rusage (struct thread *t, struct rusage *usage)
+{
+  *usage = t->usage;
+#ifdef VM
+  if (t->rss_peak > usage->peak)
+    usage->peak = t->rss_peak;
+#else
+  usage->peak = 0;
+#endif
+}
+
+/* Adds resource usage B into A. */
+static void
+add_rusage (struct rusage *a, const struct rusage *b)
+{
+  a->ticks += b->ticks;
+  a->syscalls += b->syscalls;
+  a->read_bytes += b->read_bytes;
+  a->write_bytes += b->write_bytes;
+  a->page_faults += b->page_faults;
+  if (b->peak > a->peak)
+    a->peak = b->peak;
 }
 
 /* Free the current process's resources. */
@@ -156,41 +548,24 @@ process_exit (void)
   struct thread *t = thread_current();
   uint32_t *pd;
   
-  /* Check if parent is dead. */
-  struct child_status *cs = t->cs;
-  if (t->cs != NULL) {
-    lock_acquire(&cs->l);
-    cs->ref_cnt--;
-    cs->exit_status = t->exit_status;
-    lock_release(&cs->l);
-
-    if(cs->ref_cnt == 0) {
-      free(cs);
-    } else {
-      sema_up(&cs->sema_wait);
-    }
-  }
+  /* Let outstanding asynchronous I/O finish before the files it
+     uses are closed for good. */
+  aio_exit ();
+  shm_exit ();
 
-  /* Check if any children are dead. */
-  struct list_elem *e;
-  lock_acquire(&t->cs_lock);
-  for (e = list_begin (&t->cs_list); e != list_end (&t->cs_list);
-    e = list_next (e))
-  {
-    struct child_status *cs = list_entry (e, struct child_status, cs_elem);
-
-    lock_acquire(&cs->l);
-    cs->ref_cnt--;
-    lock_release(&cs->l);
-
-    if(cs->ref_cnt == 0) {
-      free(cs);
-    }
-  }
-  lock_release(&t->cs_lock);
+  exit_children ();
 
   if (t->load_success)
     printf("%s: exit(%d)\n", t->name, t->exit_status);
+  if (process_report_usage && t->load_success)
+    {
+      struct rusage usage;
+      get_own_rusage (t, &usage);
+      printf ("%s: usage: %lld ticks, %lld syscalls, %lld bytes read, "
+              "%lld bytes written, %lld page faults, peak %d pages\n",
+              t->name, usage.ticks, usage.syscalls, usage.read_bytes,
+              usage.write_bytes, usage.page_faults, usage.peak);
+    }
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -204,10 +579,27 @@ process_exit (void)
          directory before destroying the process's page
          directory, or our active page directory will be one
          that's been freed (and cleared). */
+#ifdef VM
+      if (process_report_memory && t->load_success)
+        {
+          struct memstat usage;
+          frame_get_usage (&usage);
+          printf ("%s: memory: %d resident, %d swapped, %d shared, "
+                  "peak %d pages\n", t->name, usage.resident,
+                  usage.swapped, usage.shared, usage.peak);
+        }
+      mmap_destroy_all ();
+      page_table_destroy ();
+#endif
       t->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* Allow writes to the executable again, now that no page of
+     ours can be read from it any more. */
+  file_close (t->exec_file);
+  t->exec_file = NULL;
 }
 
 /* Sets up the CPU for running user code in the current
@@ -289,32 +681,95 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
+/* Maximum size of the loader's read-ahead window, in pages. */
+#define READAHEAD_PAGES 16
+
+/* Read-ahead window for loading an executable.
+
+   Segments are read from the file a window of up to
+   READAHEAD_PAGES pages at a time, which the disk driver
+   transfers with a single multi-sector command, rather than one
+   page and one sector at a time.  Since a window extends past
+   the end of the segment being loaded, a following segment that
+   starts in the same or the next few pages of the file, as the
+   data segment usually does after the code segment, is found in
+   the window without reading the file again. */
+struct readahead
+  {
+    uint8_t *buf;               /* Window, or null if not allocated. */
+    size_t page_cnt;            /* Size of BUF in pages. */
+    off_t ofs;                  /* File offset of BUF[0]. */
+    off_t length;               /* Bytes of BUF that are valid. */
+  };
+
+static void readahead_init (struct readahead *);
+static void readahead_done (struct readahead *);
+
 static bool setup_stack (void **esp);
+static struct image *read_image (struct file *, const char *file_name);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
-static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
-                          uint32_t read_bytes, uint32_t zero_bytes,
-                          bool writable);
+static bool load_segment (struct file *file, struct readahead *,
+                          struct image *, int segment);
+
+/* Builds the initial user stack below *ESP from ARGS, which fits
+   in the stack's first page (see EXEC_STRINGS_SIZE): the argument
+   strings, copied as one block, then argv[], argv and argc, and a
+   fake return address.  Updates *ESP to point to the latter. */
+static void
+push_args (const struct exec_args *args, void **esp)
+{
+  char **argv;
+  char *arg;
+  int i;
+
+  *esp = (uint8_t *) *esp - args->size;
+  memcpy (*esp, args->strings, args->size);
+  arg = *esp;
+
+  /* Align with word size 4, then push argv[] with its null
+     terminator. */
+  *esp = (void *) ((uintptr_t) *esp & ~3u);
+  argv = (char **) *esp - (args->argc + 1);
+  for (i = 0; i < args->argc; i++)
+    {
+      argv[i] = arg;
+      arg += strlen (arg) + 1;
+    }
+  argv[args->argc] = NULL;
+  *esp = argv;
+
+  /* Push argv, argc and a fake return address. */
+  *esp = (char ***) *esp - 1;
+  *(char ***) *esp = argv;
+  *esp = (int *) *esp - 1;
+  *(int *) *esp = args->argc;
+  *esp = (void **) *esp - 1;
+  *(void **) *esp = NULL;
+}
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Loads an ELF executable from ARGS->file_name into the current
+   thread, with its arguments from ARGS on the stack.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const struct exec_args *args, void (**eip) (void), void **esp) 
 {
   // printf("[DEBUG] Load begin\n");
-  struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  const char *file_name = args->file_name;
+  uint64_t start = rdtsc ();
   struct file *file = NULL;
-  off_t file_ofs;
+  struct image *img = NULL;
+  struct readahead ra;
   bool success = false;
+  bool hit;
   int i;
 
+  readahead_init (&ra);
+
   /* Allocate and activate page directory. */
-  t->pagedir = pagedir_create ();
-  if (t->pagedir == NULL) 
+  if (!create_address_space ())
     goto done;
-  process_activate ();
 
   /* Set up stack. */
   if (!setup_stack (esp)){
@@ -322,53 +777,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
   }
 
   /* Push arguments on stack. */
-  char *argv[32];
-  int argc = 0; 
-  char *token, *save_ptr;
-  char *fn_copy;
-
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
-    return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
-  
-  file_name = strtok_r(file_name, " ", &save_ptr);
-      
-  /* Push argv values. */
-  for (token = strtok_r (fn_copy, " ", &save_ptr); token != NULL;
-      token = strtok_r (NULL, " ", &save_ptr))
-  {
-    *esp -= strlen(token) + 1;
-    memcpy(*esp, token, strlen(token) + 1);
-    argv[argc++] = (char*) *esp;
-    if(argc == 31) 
-      break;
-  }
-  argv[argc] = 0;
-
-  /* Align with word size 4. */ 
-  uint8_t a = (size_t) *esp % 4;
-  if (a)
-    {
-      *esp -= a;
-      memcpy(*esp, &argv[argc], a);
-    }
-
-  for (i = argc; i >= 0; i--) {
-    *esp -= sizeof(argv[i]);
-    memcpy(*esp, &argv[i], sizeof(argv[i]));
-  } 
-
-  /* Push argv. */
-  void* tmp = *esp;
-  *esp -= sizeof(&tmp);
-  memcpy(*esp, &tmp, sizeof(&tmp));
-  /* Push argc. */
-  *esp -= sizeof(argc);
-  memcpy(*esp, &argc, sizeof(argc));
-  /* Push fake return address */
-  *esp -= sizeof(argv[argc]);
-  memcpy(*esp, &argv[argc], sizeof(argv[argc]));
+  push_args (args, esp);
 
   /* Uncomment the following line to print some debug
     information. This will be useful when you debug the program
@@ -417,9 +826,95 @@ load (const char *file_name, void (**eip) (void), void **esp)
       goto done; 
     }
 
+  /* Keep the executable open and unmodified while it runs, so
+     that its pages can be read from it again.  process_exit()
+     closes it. */
+  file_deny_write (file);
+  thread_current ()->exec_file = file;
+
   // printf("[DEBUG] Executable '%s' opened.\n", file_name);
 
+  /* Find the executable's headers in the image cache, or read
+     and verify them. */
+  img = image_lookup (file_get_inode (file));
+  hit = img != NULL;
+  if (img == NULL)
+    img = read_image (file, file_name);
+  if (img == NULL)
+    goto done;
+
+  /* Load segments. */
+  for (i = 0; i < img->segment_cnt; i++)
+    if (!load_segment (file, &ra, img, i))
+      goto done;
+
+  // printf("[DEBUG] Executable '%s' validated and loaded.\n", file_name);
+
+  /* Start address. */
+  *eip = img->entry;
+
+  image_note_load (hit, rdtsc () - start);
+  success = true;
+
+ done:
+  /* We arrive here whether the load is successful or not. */
+  if (img != NULL)
+    image_release (img);
+  readahead_done (&ra);
+  return success;
+}
+
+/* Gives the current thread an empty user address space and
+   activates it.  Returns true if successful, false if memory
+   allocation fails. */
+static bool
+create_address_space (void)
+{
+  struct thread *t = thread_current ();
+
+#ifdef VM
+  /* Allocate supplemental page table. */
+  list_init (&t->mappings);
+  t->next_mapid = 0;
+  if (!page_table_init ())
+    return false;
+#endif
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL) 
+    {
+#ifdef VM
+      page_table_destroy ();
+#endif
+      return false;
+    }
+  process_activate ();
+  return true;
+}
+
+/* load() helpers. */
+
+#ifndef VM
+static bool install_page (void *upage, void *kpage, bool writable);
+#endif
+
+/* Reads and verifies the ELF header and program headers of FILE,
+   named FILE_NAME, and returns them as a new image in the image
+   cache, which the caller must release with image_release().
+   Returns a null pointer if FILE is not a valid executable or
+   memory is short. */
+static struct image *
+read_image (struct file *file, const char *file_name)
+{
+  struct Elf32_Ehdr ehdr;
+  struct image_segment *segments;
+  struct image *img = NULL;
+  int segment_cnt = 0;
+  off_t file_ofs;
+  int i;
+
   /* Read and verify executable header. */
+  file_seek (file, 0);
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
@@ -429,9 +924,13 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phnum > 1024) 
     {
       printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
+      return NULL;
     }
 
+  segments = malloc (ehdr.e_phnum * sizeof *segments);
+  if (segments == NULL && ehdr.e_phnum > 0)
+    return NULL;
+
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++) 
@@ -461,29 +960,29 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_LOAD:
           if (validate_segment (&phdr, file)) 
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
+              struct image_segment *seg = &segments[segment_cnt++];
               uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
+
+              seg->ofs = phdr.p_offset & ~PGMASK;
+              seg->upage = (uint8_t *) (phdr.p_vaddr & ~PGMASK);
+              seg->writable = (phdr.p_flags & PF_W) != 0;
               if (phdr.p_filesz > 0)
                 {
                   /* Normal segment.
                      Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                  seg->read_bytes = page_offset + phdr.p_filesz;
+                  seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz,
+                                               PGSIZE)
+                                     - seg->read_bytes);
                 }
               else 
                 {
                   /* Entirely zero.
                      Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                  seg->read_bytes = 0;
+                  seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz,
+                                              PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
             }
           else
             goto done;
@@ -491,23 +990,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
-  // printf("[DEBUG] Executable '%s' validated and loaded.\n", file_name);
-
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
-
-  success = true;
+  img = image_create (file_get_inode (file),
+                      (void (*) (void)) ehdr.e_entry,
+                      segments, segment_cnt);
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
-  return success;
+  free (segments);
+  return img;
 }
 
-/* load() helpers. */
-
-static bool install_page (void *upage, void *kpage, bool writable);
-
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -553,47 +1044,168 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   return true;
 }
 
-/* Loads a segment starting at offset OFS in FILE at address
-   UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
-   memory are initialized, as follows:
+/* Prepares RA for use. */
+static void
+readahead_init (struct readahead *ra) 
+{
+  ra->buf = NULL;
+  ra->page_cnt = 0;
+  ra->ofs = 0;
+  ra->length = 0;
+}
+
+/* Frees the window of RA. */
+static void
+readahead_done (struct readahead *ra) 
+{
+  if (ra->buf != NULL)
+    palloc_free_multiple (ra->buf, ra->page_cnt);
+}
+
+/* Returns a pointer to the SIZE bytes at offset OFS in FILE,
+   which must be page-aligned, reading them and the file pages
+   that follow into RA's window if they are not there already.
+   Returns a null pointer if memory for the window cannot be
+   allocated or FILE cannot be read. */
+static const void *
+readahead_get (struct readahead *ra, struct file *file, off_t ofs,
+               size_t size) 
+{
+  ASSERT (ofs % PGSIZE == 0);
+  ASSERT (size <= PGSIZE);
+
+  if (ofs >= ra->ofs && ofs + (off_t) size <= ra->ofs + ra->length)
+    return ra->buf + (ofs - ra->ofs);
+
+  /* Allocate the window the first time, settling for a smaller
+     one if kernel memory is short. */
+  if (ra->buf == NULL)
+    for (ra->page_cnt = READAHEAD_PAGES; ra->page_cnt > 0; ra->page_cnt /= 2)
+      {
+        ra->buf = palloc_get_multiple (0, ra->page_cnt);
+        if (ra->buf != NULL)
+          break;
+      }
+  if (ra->buf == NULL)
+    return NULL;
+
+  ra->ofs = ofs;
+  ra->length = file_read_at (file, ra->buf, ra->page_cnt * PGSIZE, ofs);
+  return ra->length >= (off_t) size ? ra->buf : NULL;
+}
+
+/* Returns a pointer to the SIZE bytes of page PAGE of segment
+   SEGMENT of IMG, at offset OFS in FILE, taking them from IMG if
+   they are cached there, or reading them through RA otherwise
+   and caching them in IMG if the segment is read-only.
+   Returns a null pointer if FILE cannot be read. */
+static const void *
+read_page (struct file *file, struct readahead *ra, struct image *img,
+           int segment, size_t page, off_t ofs, size_t size) 
+{
+  const void *data = image_get_page (img, segment, page);
+  if (data == NULL)
+    {
+      data = readahead_get (ra, file, ofs, size);
+      if (data != NULL)
+        image_put_page (img, segment, page, data, size);
+    }
+  return data;
+}
+
+/* Loads segment SEGMENT of IMG from FILE, reading FILE through
+   RA.  In total, READ_BYTES + ZERO_BYTES bytes of virtual memory
+   are initialized at the segment's UPAGE, as follows:
 
         - READ_BYTES bytes at UPAGE must be read from FILE
-          starting at offset OFS.
+          starting at the segment's offset OFS.
 
         - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.
 
    The pages initialized by this function must be writable by the
-   user process if WRITABLE is true, read-only otherwise.
+   user process if the segment is writable, read-only otherwise.
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
-load_segment (struct file *file, off_t ofs, uint8_t *upage,
-              uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
+load_segment (struct file *file, struct readahead *ra, struct image *img,
+              int segment) 
 {
+  const struct image_segment *seg = &img->segments[segment];
+  off_t ofs = seg->ofs;
+  uint8_t *upage = seg->upage;
+  uint32_t read_bytes = seg->read_bytes;
+  uint32_t zero_bytes = seg->zero_bytes;
+  bool writable = seg->writable;
+  size_t page;
+
   ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
-  file_seek (file, ofs);
-  while (read_bytes > 0 || zero_bytes > 0) 
+  for (page = 0; read_bytes > 0 || zero_bytes > 0; page++)
     {
       /* Calculate how to fill this page.
          We will read PAGE_READ_BYTES bytes from FILE
          and zero the final PAGE_ZERO_BYTES bytes. */
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
+      const void *data = NULL;
 
+#ifdef VM
+      /* A failed load destroys the page table, so there is
+         nothing to clean up here. */
+      struct page *p = page_create (upage, writable);
+      if (p == NULL)
+        return false;
+      if (!writable)
+        {
+          /* Read-only pages are read from the executable, or
+             shared with another process running it, in which
+             case there is nothing to read. */
+          p->file = file;
+          p->file_ofs = ofs;
+          p->read_bytes = page_read_bytes;
+          if (!frame_share_text (p))
+            {
+              data = read_page (file, ra, img, segment, page, ofs,
+                                page_read_bytes);
+              if (data == NULL || !page_in_from (p, data))
+                return false;
+            }
+        }
+      else
+        {
+          /* Add a zeroed page and copy its initial part while
+             its frame is pinned. */
+          if (page_read_bytes > 0)
+            {
+              data = readahead_get (ra, file, ofs, page_read_bytes);
+              if (data == NULL)
+                return false;
+            }
+          if (!page_in (p))
+            return false;
+          memcpy (p->frame->kpage, data, page_read_bytes);
+        }
+      page_unpin (p);
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
         return false;
 
       /* Load this page. */
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
+      if (page_read_bytes > 0)
         {
-          palloc_free_page (kpage);
-          return false; 
+          data = read_page (file, ra, img, segment, page, ofs,
+                            page_read_bytes);
+          if (data == NULL)
+            {
+              palloc_free_page (kpage);
+              return false; 
+            }
+          memcpy (kpage, data, page_read_bytes);
         }
       memset (kpage + page_read_bytes, 0, page_zero_bytes);
 
@@ -603,10 +1215,12 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
       upage += PGSIZE;
     }
   return true;
@@ -617,6 +1231,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp) 
 {
+#ifdef VM
+  struct page *p = page_create (((uint8_t *) PHYS_BASE) - PGSIZE, true);
+  if (p == NULL || !page_in (p))
+    return false;
+  page_unpin (p);
+  *esp = PHYS_BASE;
+  return true;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -630,8 +1252,10 @@ setup_stack (void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -651,3 +1275,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
@@ -1,10 +1,50 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/directory.h"
 #include "threads/thread.h"
 
-tid_t process_execute (const char *file_name);
+struct file;
+struct intr_frame;
+
+/* Most arguments a process may be started with. */
+#define EXEC_ARGS_MAX 64
+
+/* Room for argument strings.  Together with argv[] they must fit
+   in the first page of the new process's stack. */
+#define EXEC_STRINGS_SIZE 3072
+
+/* What a new process is started with, all in one page (see
+   exec_args_create()). */
+struct exec_args
+  {
+    char file_name[NAME_MAX + 1]; /* Executable. */
+    int argc;                   /* Number of arguments. */
+    size_t size;                /* Bytes of STRINGS in use. */
+    struct file *pipes[FD_SIZE]; /* Inherited file descriptors, or null. */
+    char strings[EXEC_STRINGS_SIZE]; /* ARGC null-terminated arguments. */
+  };
+
+#ifdef VM
+/* -memstat: Report each process's memory use when it exits? */
+extern bool process_report_memory;
+#endif
+
+/* -rusage: Report each process's resource usage when it exits? */
+extern bool process_report_usage;
+
+tid_t process_execute (const char *cmd_line);
+struct exec_args *exec_args_create (void);
+bool exec_args_push (struct exec_args *, const char *, size_t len);
+tid_t process_spawn (struct exec_args *, bool wait_load);
+tid_t process_fork (struct intr_frame *);
 int process_wait (tid_t);
+tid_t process_waitpid (tid_t, int *status, int options);
+void process_init (void);
+bool process_add_child (struct thread *);
+void process_get_rusage (int who, struct rusage *);
 void process_exit (void);
 void process_activate (void);
 
@@ -0,0 +1,375 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/layout.h"
+#include "userprog/pagedir.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Shared memory segments.
+
+   A segment is a set of frames from the user pool, named by an
+   integer key.  Each process that attaches it gets the same
+   frames mapped straight into its page directory, somewhere in
+   the SHM_AREA_SIZE bytes set aside for it in userprog/layout.h,
+   outside the supplemental page table, so its pages are
+   never evicted.  A segment is freed when the last process
+   detaches it; processes detach everything at exit, and nothing
+   is inherited across fork or exec.
+
+   shm_wait() and shm_wake() let processes sleep on and wake on an
+   int in a segment, futex style.  Waiters are matched by the
+   kernel address of the int, so processes that attach the segment
+   at different addresses still meet. */
+
+/* A shared memory segment. */
+struct segment
+  {
+    struct list_elem elem;      /* Element in segments. */
+    int key;                    /* Name. */
+    size_t page_cnt;            /* Number of pages. */
+    void **kpages;              /* Kernel addresses of frames. */
+    int attach_cnt;             /* Number of attachments. */
+  };
+
+/* A segment attached to a process. */
+struct attachment
+  {
+    struct list_elem elem;      /* Element in shm_attachments. */
+    struct segment *seg;        /* Segment. */
+    uint8_t *upage;             /* User address of first page. */
+  };
+
+/* A process sleeping in shm_wait(). */
+struct waiter
+  {
+    struct list_elem elem;      /* Element in waiters. */
+    const int *kaddr;           /* Kernel address waited on. */
+    struct semaphore sema;      /* Upped by shm_wake(). */
+  };
+
+static struct list segments;    /* All segments. */
+static struct list waiters;     /* All waiters. */
+static struct lock shm_lock;    /* Protects everything in this file. */
+
+static void *attach (struct segment *);
+static void detach (struct attachment *);
+
+/* Initializes shared memory. */
+void
+shm_init (void)
+{
+  list_init (&segments);
+  list_init (&waiters);
+  lock_init (&shm_lock);
+}
+
+/* Returns the segment named KEY, or a null pointer if there is
+   none. */
+static struct segment *
+find_segment (int key)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e))
+    {
+      struct segment *seg = list_entry (e, struct segment, elem);
+      if (seg->key == key)
+        return seg;
+    }
+  return NULL;
+}
+
+/* Frees SEG, which must not be in the segment list. */
+static void
+free_segment (struct segment *seg)
+{
+  size_t i;
+
+  for (i = 0; i < seg->page_cnt; i++)
+    palloc_free_page (seg->kpages[i]);
+  free (seg->kpages);
+  free (seg);
+}
+
+/* Creates a zeroed segment of SIZE bytes named KEY and attaches
+   it to the current process.  Returns its user address, or a
+   null pointer if a segment named KEY already exists, SIZE is 0
+   or more than SHM_MAX_PAGES pages, or memory is short. */
+void *
+shm_create (int key, size_t size)
+{
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  struct segment *seg;
+  void *upage = NULL;
+
+  if (page_cnt == 0 || page_cnt > SHM_MAX_PAGES)
+    return NULL;
+
+  lock_acquire (&shm_lock);
+  if (find_segment (key) != NULL)
+    goto done;
+
+  seg = malloc (sizeof *seg);
+  if (seg == NULL)
+    goto done;
+  seg->kpages = calloc (page_cnt, sizeof *seg->kpages);
+  if (seg->kpages == NULL)
+    {
+      free (seg);
+      goto done;
+    }
+  seg->key = key;
+  seg->attach_cnt = 0;
+  for (seg->page_cnt = 0; seg->page_cnt < page_cnt; seg->page_cnt++)
+    {
+      seg->kpages[seg->page_cnt] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (seg->kpages[seg->page_cnt] == NULL)
+        {
+          free_segment (seg);
+          goto done;
+        }
+    }
+
+  upage = attach (seg);
+  if (upage != NULL)
+    list_push_back (&segments, &seg->elem);
+  else
+    free_segment (seg);
+
+ done:
+  lock_release (&shm_lock);
+  return upage;
+}
+
+/* Attaches the segment named KEY to the current process and
+   returns its user address, or a null pointer if there is no
+   such segment or no room for it. */
+void *
+shm_attach (int key)
+{
+  struct segment *seg;
+  void *upage = NULL;
+
+  lock_acquire (&shm_lock);
+  seg = find_segment (key);
+  if (seg != NULL)
+    upage = attach (seg);
+  lock_release (&shm_lock);
+
+  return upage;
+}
+
+/* Detaches the segment attached at user address ADDR from the
+   current process.  Returns false if there is none. */
+bool
+shm_detach (void *addr)
+{
+  struct list *attachments = &thread_current ()->shm_attachments;
+  struct list_elem *e;
+  bool found = false;
+
+  lock_acquire (&shm_lock);
+  for (e = list_begin (attachments); e != list_end (attachments);
+       e = list_next (e))
+    {
+      struct attachment *a = list_entry (e, struct attachment, elem);
+      if (a->upage == addr)
+        {
+          detach (a);
+          found = true;
+          break;
+        }
+    }
+  lock_release (&shm_lock);
+
+  return found;
+}
+
+/* Detaches every segment from the current process.  Must be
+   called before its page directory is destroyed. */
+void
+shm_exit (void)
+{
+  struct list *attachments = &thread_current ()->shm_attachments;
+
+  lock_acquire (&shm_lock);
+  while (!list_empty (attachments))
+    detach (list_entry (list_front (attachments), struct attachment, elem));
+  lock_release (&shm_lock);
+}
+
+/* Returns true if user page UPAGE of the current process is not
+   in use. */
+static bool
+page_is_free (const void *upage)
+{
+  if (pagedir_get_page (thread_current ()->pagedir, upage) != NULL)
+    return false;
+#ifdef VM
+  if (page_lookup (upage) != NULL)
+    return false;
+#endif
+  return true;
+}
+
+/* Maps SEG into the first free range of the current process's
+   shared memory area and returns its user address, or a null
+   pointer if there is no room or memory is short. */
+static void *
+attach (struct segment *seg)
+{
+  struct thread *t = thread_current ();
+  size_t size = seg->page_cnt * PGSIZE;
+  struct attachment *a;
+  uint8_t *upage;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&shm_lock));
+
+  for (upage = SHM_BASE; upage + size <= SHM_TOP; upage += PGSIZE)
+    {
+      for (i = 0; i < seg->page_cnt; i++)
+        if (!page_is_free (upage + i * PGSIZE))
+          break;
+      if (i == seg->page_cnt)
+        break;
+    }
+  if (upage + size > SHM_TOP)
+    return NULL;
+
+  a = malloc (sizeof *a);
+  if (a == NULL)
+    return NULL;
+  for (i = 0; i < seg->page_cnt; i++)
+    if (!pagedir_set_page (t->pagedir, upage + i * PGSIZE,
+                           seg->kpages[i], true))
+      {
+        while (i-- > 0)
+          pagedir_clear_page (t->pagedir, upage + i * PGSIZE);
+        free (a);
+        return NULL;
+      }
+
+  a->seg = seg;
+  a->upage = upage;
+  list_push_back (&t->shm_attachments, &a->elem);
+  seg->attach_cnt++;
+  return upage;
+}
+
+/* Unmaps and frees attachment A of the current process, and frees
+   its segment if that was the last attachment. */
+static void
+detach (struct attachment *a)
+{
+  struct segment *seg = a->seg;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&shm_lock));
+
+  for (i = 0; i < seg->page_cnt; i++)
+    pagedir_clear_page (thread_current ()->pagedir, a->upage + i * PGSIZE);
+  list_remove (&a->elem);
+  free (a);
+
+  if (--seg->attach_cnt == 0)
+    {
+      list_remove (&seg->elem);
+      free_segment (seg);
+    }
+}
+
+/* Returns the kernel address of the int at user address UADDR,
+   which must be aligned and in a segment attached to the current
+   process, or a null pointer if it is not. */
+static int *
+kernel_addr (const int *uaddr)
+{
+  struct list *attachments = &thread_current ()->shm_attachments;
+  const uint8_t *addr = (const uint8_t *) uaddr;
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&shm_lock));
+
+  if ((uintptr_t) addr % sizeof *uaddr != 0)
+    return NULL;
+  for (e = list_begin (attachments); e != list_end (attachments);
+       e = list_next (e))
+    {
+      struct attachment *a = list_entry (e, struct attachment, elem);
+      if (addr >= a->upage && addr < a->upage + a->seg->page_cnt * PGSIZE)
+        {
+          size_t ofs = addr - a->upage;
+          return (int *) ((uint8_t *) a->seg->kpages[ofs / PGSIZE]
+                          + ofs % PGSIZE);
+        }
+    }
+  return NULL;
+}
+
+/* If the int at user address UADDR in a shared memory segment
+   holds VAL, sleeps until shm_wake() is called on it.  Returns 0
+   after sleeping, or -1 at once if UADDR is not in a segment or
+   does not hold VAL. */
+int
+shm_wait (const int *uaddr, int val)
+{
+  struct waiter w;
+  int *kaddr;
+
+  lock_acquire (&shm_lock);
+  kaddr = kernel_addr (uaddr);
+  if (kaddr == NULL || *kaddr != val)
+    {
+      lock_release (&shm_lock);
+      return -1;
+    }
+  w.kaddr = kaddr;
+  sema_init (&w.sema, 0);
+  list_push_back (&waiters, &w.elem);
+  lock_release (&shm_lock);
+
+  sema_down (&w.sema);
+  return 0;
+}
+
+/* Wakes up to CNT processes sleeping in shm_wait() on the int at
+   user address UADDR, in the order they went to sleep.  Returns
+   the number woken, or -1 if UADDR is not in a segment. */
+int
+shm_wake (const int *uaddr, int cnt)
+{
+  struct list_elem *e;
+  int *kaddr;
+  int woken = 0;
+
+  lock_acquire (&shm_lock);
+  kaddr = kernel_addr (uaddr);
+  if (kaddr == NULL)
+    woken = -1;
+  else
+    for (e = list_begin (&waiters); e != list_end (&waiters) && woken < cnt; )
+      {
+        struct waiter *w = list_entry (e, struct waiter, elem);
+        if (w->kaddr == kaddr)
+          {
+            e = list_remove (e);
+            sema_up (&w->sema);
+            woken++;
+          }
+        else
+          e = list_next (e);
+      }
+  lock_release (&shm_lock);
+
+  return woken;
+}
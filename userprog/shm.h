@@ -0,0 +1,18 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Largest segment, in pages. */
+#define SHM_MAX_PAGES 64
+
+void shm_init (void);
+void *shm_create (int key, size_t size);
+void *shm_attach (int key);
+bool shm_detach (void *addr);
+int shm_wait (const int *uaddr, int val);
+int shm_wake (const int *uaddr, int cnt);
+void shm_exit (void);
+
+#endif /* userprog/shm.h */
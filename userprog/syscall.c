@@ -1,15 +1,34 @@
 #include "userprog/syscall.h"
+#include <limits.h>
+#include <rdtsc.h>
+#include <round.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/init.h"
 #include "threads/vaddr.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "filesys/pipe.h"
 #include "devices/input.h"
+#include "devices/timer.h"
+#include "userprog/aio.h"
+#include "userprog/layout.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/shm.h"
+#include "userprog/tss.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
-static void syscall_handler (struct intr_frame *);
 
 void
 syscall_init (void) 
@@ -38,22 +57,10 @@ put_user (uint8_t *udst, uint8_t byte)
 {
   int error_code;
   asm ("movl $1f, %0; movb %b2, %1; 1:"
-     : "=&a" (error_code), "=m" (*udst) : "r" (byte));
+     : "=&a" (error_code), "=m" (*udst) : "q" (byte));
   return error_code != -1;
 }
 
-/* Validate and return argument n. */
-static uint32_t
-get_argument(void* esp, int argn)
-{
-  uint32_t* argv = esp + (argn + 1) * 4;
-  if(get_user(argv + 3) != -1) /* Test last byte of argument. */
-    return *argv;
-  thread_current()->exit_status = -1;
-  thread_exit();
-  NOT_REACHED();
-}
-
 /* Execute system call halt. */
 static void
 halt( void )
@@ -61,35 +68,110 @@ halt( void )
   power_off();
 }
 
-/* Check for null arguments and bad pointers. */
-static void
-validate_pointer(char *c, unsigned int size) {
-  if (size == 0) {
-    if(c == NULL || !is_user_vaddr(c) || get_user(c) == -1) {
-       thread_current()->exit_status = -1;
-       thread_exit();
-    }
-  } else {
-    int n;
-    for(n = 0; n < size; n++) {
-      if(c+n == NULL || !is_user_vaddr(c+n) || get_user(c+n) == -1) {
-        thread_current()->exit_status = -1;
-        thread_exit();
-      }
+/* Returns true if the SIZE bytes starting at UADDR all lie below
+   PHYS_BASE.  Whether they are mapped is found out while copying
+   them. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  return end >= (const uint8_t *) uaddr && (void *) end <= PHYS_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, a word at a time, where one
+   of them is a user address that may be invalid.  A page fault
+   on a bad user address resumes at label 1 with EAX = -1, just as
+   in get_user() and put_user().
+   Returns true if successful, false if a page fault occurred. */
+static bool
+copy_checked (void *dst, const void *src, size_t size)
+{
+  int result, d0, d1, d2;
+  asm volatile ("movl $1f, %%eax; rep movsl; movl %7, %%ecx; rep movsb;"
+                "xorl %%eax, %%eax; 1:"
+                : "=&a" (result), "=&c" (d0), "=&D" (d1), "=&S" (d2)
+                : "1" (size / 4), "2" (dst), "3" (src), "r" (size % 4)
+                : "memory");
+  return result == 0;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if USRC is not a valid
+   user buffer. */
+static bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && copy_checked (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if UDST is not a valid,
+   writable user buffer. */
+static bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return is_user_range (udst, size) && copy_checked (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   the SIZE bytes at DST.  Returns the length of the string, SIZE
+   if it does not fit (in which case DST is not null-terminated),
+   or -1 if USRC is not a valid user string. */
+static int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  const uint8_t *src = (const uint8_t *) usrc;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      int c;
+
+      /* A valid page cannot contain an invalid address, so
+         check only when entering a new one. */
+      if ((i == 0 || pg_ofs (src + i) == 0) && !is_user_vaddr (src + i))
+        return -1;
+      c = get_user (src + i);
+      if (c == -1)
+        return -1;
+      dst[i] = c;
+      if (c == '\0')
+        return i;
     }
-  }
+  return size;
+}
+
+/* Terminates the current process for passing a bad pointer. */
+static void
+kill_process (void)
+{
+  thread_current()->exit_status = -1;
+  thread_exit();
+}
+
+/* Copies the file name at user address UNAME into NAME, which has
+   room for NAME_BUF_SIZE bytes, killing the process if UNAME is
+   invalid.  Returns false if the name is too long to be the name
+   of any file. */
+#define NAME_BUF_SIZE (NAME_MAX + 1)
+static bool
+get_file_name (char name[NAME_BUF_SIZE], const char *uname)
+{
+  int len = strncpy_from_user (name, uname, NAME_BUF_SIZE);
+  if (len < 0)
+    kill_process ();
+  return len < NAME_BUF_SIZE;
 }
 
 /* Execute system call create. */
 static bool
-create( void *esp )
+create( const char *uname, unsigned int size )
 {
-  /* Get arguments. */
-  const char* name = get_argument(esp, 0);
-  unsigned int size = get_argument(esp, 1);
+  char name[NAME_BUF_SIZE];
   
   /* Check for null arguments and bad pointers. */
-  validate_pointer(name, size);
+  if (!get_file_name(name, uname))
+    return false;
 
   /* Try to create file. */
   bool status = filesys_create(name, size);
@@ -100,12 +182,13 @@ create( void *esp )
 
 /* Execute system call open. */
 static int
-open( void *esp )
+open( const char *uname )
 {
   /* Open file in filesystem. */
-  const char* name = get_argument(esp, 0);
+  char name[NAME_BUF_SIZE];
   /* Check for null arguments and bad pointers. */
-  validate_pointer(name, 14); // Filename is maximum of 14 chars.
+  if (!get_file_name(name, uname))
+    return -1;
   
   /* Create file descriptor. */
   struct thread* t = thread_current();
@@ -134,91 +217,585 @@ valid_fd(int fd)
           bitmap_test(t->fd_bitmap, fd);
 }
 
-/* Execute system call write. */
+/* Execute system call write, or pwrite if OFS is nonnegative:
+   writes at byte offset OFS in the file instead of at the file
+   position, which is left alone. */
 static int
-write(void *esp)
-{
-  /* Get arguments. */
-  int fd = get_argument(esp, 0);
-  const void* buffer = get_argument(esp, 1);
-  unsigned int size = get_argument(esp, 2);
-
-  validate_pointer(buffer, size);
-
-  if(fd == STDOUT_FILENO) {
-    int n = size;
-    
-    while(n >= CONSOLE_BUFFER_SIZE) {
-      putbuf(buffer, CONSOLE_BUFFER_SIZE);
-      n -= CONSOLE_BUFFER_SIZE;
-      buffer += CONSOLE_BUFFER_SIZE;
-    }
-  
-    putbuf(buffer, n);    
-  
-    return size;
-  } else if (fd == STDIN_FILENO) {
+write(int fd, const uint8_t *buffer, unsigned int size, off_t ofs)
+{
+  struct file* f = NULL;
+  unsigned int chunk_max = CONSOLE_BUFFER_SIZE;
+  unsigned int done;
+  uint8_t* kbuf;
+
+  if(!is_user_range(buffer, size))
+    kill_process();
+
+  if (fd == STDIN_FILENO) {
     return -1; // Can't write to read from console.
-  } else {  // Write to file with fd.
+  } else if (fd != STDOUT_FILENO) {  // Write to file with fd.
     /* File descriptors 0 & 1 are reserved for console. Skip those.*/
     fd -= 2; 
 
     /* Control file descriptor. */
     if(!valid_fd(fd))
       return -1;
+    f = thread_current()->files[fd];
+    chunk_max = PGSIZE;
+  }
 
-    struct file* f = thread_current()->files[fd];
-    return file_write(f, buffer, size);
+  /* Copy the buffer in a page at a time, so that no user page is
+     touched while the file system is busy. */
+  kbuf = palloc_get_page(0);
+  if (kbuf == NULL)
+    return -1;
+  for (done = 0; done < size; ) {
+    unsigned int chunk = size - done < chunk_max ? size - done : chunk_max;
+    int n;
+
+    if (!copy_from_user(kbuf, buffer + done, chunk)) {
+      palloc_free_page(kbuf);
+      kill_process();
+    }
+    if (f == NULL) {
+      putbuf((const char *) kbuf, chunk);
+      n = chunk;
+    } else
+      n = ofs < 0 ? file_write(f, kbuf, chunk)
+                  : file_write_at(f, kbuf, chunk, ofs + done);
+
+    if (n < 0) {
+      palloc_free_page(kbuf);
+      return done > 0 ? (int) done : -1;
+    }
+    done += n;
+    if (n < (int) chunk)
+      break;
   }
+  palloc_free_page(kbuf);
+  thread_current()->usage.write_bytes += done;
+  return done;
 }
 
-/* Execute system call read. */
+/* Execute system call read, or pread if OFS is nonnegative:
+   reads from byte offset OFS in the file instead of from the file
+   position, which is left alone. */
 static int
-read( void *esp )
+read( int fd, uint8_t *buf, unsigned int size, off_t ofs )
 {
-  /* Get arguments. */
-  int fd = get_argument(esp, 0);
-  uint8_t* buf = get_argument(esp, 1);
-  unsigned int size = get_argument(esp, 2);
+  struct file* f = NULL;
+  unsigned int done;
+  uint8_t* kbuf;
 
-  validate_pointer(buf, size);  
+  if(!is_user_range(buf, size))
+    kill_process();
 
-  if (fd == STDIN_FILENO) {
-    int n = 0;
-    
-    while(n < size){
-      *buf = input_getc(); /* Get a single key from keyboard. */
-      buf++; /* Go to next element in buffer. */
-      n++;
-    }
-    
-    return n;
-  } else if (fd == STDOUT_FILENO) {
+  if (fd == STDOUT_FILENO) {
     return -1; // Can't read from write to console.
-  } else {
+  } else if (fd != STDIN_FILENO) {
     /* File descriptors 0 & 1 are reserved for console. Skip those.*/
     fd -= 2; 
     /* Control file descriptor. */
     if(!valid_fd(fd))
       return -1;
-    
-    struct file* f = thread_current()->files[fd];
-    return file_read(f, buf, size);
+    f = thread_current()->files[fd];
+  }
+
+  /* Read a page at a time into a kernel buffer and copy it out,
+     so that no user page is touched while the file system is
+     busy. */
+  kbuf = palloc_get_page(0);
+  if (kbuf == NULL)
+    return -1;
+  for (done = 0; done < size; ) {
+    unsigned int chunk = size - done < PGSIZE ? size - done : PGSIZE;
+    int n;
+
+    if (f == NULL) {
+      for (n = 0; n < (int) chunk; n++)
+        kbuf[n] = input_getc(); /* Get a single key from keyboard. */
+    } else
+      n = ofs < 0 ? file_read(f, kbuf, chunk)
+                  : file_read_at(f, kbuf, chunk, ofs + done);
+
+    if (n < 0) {
+      palloc_free_page(kbuf);
+      return -1;
+    }
+    if (n > 0 && !copy_to_user(buf + done, kbuf, n)) {
+      palloc_free_page(kbuf);
+      kill_process();
+    }
+    done += n;
+    /* A pipe returns whatever it has; reading on would wait for
+       more. */
+    if (n < (int) chunk || (f != NULL && file_is_pipe(f)))
+      break;
+  }
+  palloc_free_page(kbuf);
+  thread_current()->usage.read_bytes += done;
+  return done;
+}
+
+/* Execute system call pwrite. */
+static int
+pwrite( int fd, const uint8_t *buffer, unsigned int size, off_t ofs )
+{
+  /* The console has no file position. */
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO || ofs < 0)
+    return -1;
+  return write(fd, buffer, size, ofs);
+}
+
+/* Execute system call pread. */
+static int
+pread( int fd, uint8_t *buf, unsigned int size, off_t ofs )
+{
+  /* The console has no file position. */
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO || ofs < 0)
+    return -1;
+  return read(fd, buf, size, ofs);
+}
+
+/* Execute system call copy_file_range. */
+static int
+copy_file_range( int in_fd, int out_fd, unsigned int size )
+{
+  struct thread *t = thread_current();
+  int n;
+
+  /* File descriptors 0 & 1 are reserved for console. Skip those.*/
+  in_fd -= 2;
+  out_fd -= 2;
+  if (!valid_fd(in_fd) || !valid_fd(out_fd) || (int) size < 0)
+    return -1;
+  n = file_copy(t->files[out_fd], t->files[in_fd], size);
+  if (n > 0) {
+    t->usage.read_bytes += n;
+    t->usage.write_bytes += n;
+  }
+  return n;
+}
+
+/* Execute system call pipe: creates a pipe and stores the file
+   descriptors of its read and write ends in UFDS[0] and UFDS[1].
+   Returns 0 if successful, -1 on failure. */
+static int
+pipe( int *ufds )
+{
+  struct thread *t = thread_current();
+  struct file *read_end, *write_end;
+  size_t fds[2];
+  int user_fds[2];
+
+  if (!is_user_range(ufds, sizeof user_fds))
+    kill_process();
+
+  fds[0] = bitmap_scan_and_flip(t->fd_bitmap, 0, 1, false);
+  if (fds[0] == BITMAP_ERROR)
+    return -1;
+  fds[1] = bitmap_scan_and_flip(t->fd_bitmap, 0, 1, false);
+  if (fds[1] == BITMAP_ERROR) {
+    bitmap_reset(t->fd_bitmap, fds[0]);
+    return -1;
+  }
+  if (!pipe_create(&read_end, &write_end)) {
+    bitmap_reset(t->fd_bitmap, fds[0]);
+    bitmap_reset(t->fd_bitmap, fds[1]);
+    return -1;
+  }
+  t->files[fds[0]] = read_end;
+  t->files[fds[1]] = write_end;
+
+  /* File descriptors 0 & 1 are reserved for console. */
+  user_fds[0] = fds[0] + 2;
+  user_fds[1] = fds[1] + 2;
+  if (!copy_to_user(ufds, user_fds, sizeof user_fds))
+    kill_process();
+  return 0;
+}
+
+/* Returns the events out of EVENTS that are ready on user file
+   descriptor FD, or POLLNVAL if FD is not open.  If the
+   readiness of FD can change, stores in *Q the wait queue that
+   is woken when it does, otherwise a null pointer. */
+static short
+poll_fd( int fd, short events, struct waitq **q )
+{
+  struct file *f;
+  struct waitq *wq;
+  short revents = 0;
+
+  *q = NULL;
+  if (fd == STDIN_FILENO) {
+    *q = input_waitq();
+    return input_empty() ? 0 : events & POLLIN;
+  } else if (fd == STDOUT_FILENO)
+    return events & POLLOUT;
+
+  fd -= 2;
+  if (!valid_fd(fd))
+    return POLLNVAL;
+  f = thread_current()->files[fd];
+  if (file_poll(f, false, q))
+    revents |= events & POLLIN;
+  if (file_poll(f, true, &wq))
+    revents |= events & POLLOUT;
+  if (*q == NULL)
+    *q = wq;
+  return revents;
+}
+
+/* State of a poll() call for each of its file descriptors, too
+   big to keep on the kernel stack. */
+struct poll_buf
+  {
+    struct pollfd fds[POLL_MAX];          /* Copy of the user's array. */
+    struct waitq_entry entries[POLL_MAX]; /* Wait queue registrations. */
+    bool waiting[POLL_MAX];               /* Is entries[i] registered? */
+  };
+
+/* Execute system call poll: waits until one of the NFDS file
+   descriptors in UFDS is ready, or until TIMEOUT milliseconds
+   have passed if TIMEOUT is nonnegative.  Returns the number of
+   file descriptors with events, 0 on timeout, or -1 on error. */
+static int
+poll( struct pollfd *ufds, int nfds, int timeout )
+{
+  struct poll_buf *b;
+  struct pollfd *fds;
+  struct semaphore wakeup;
+  struct sleeper alarm;
+  int64_t start = timer_ticks();
+  int64_t ticks = DIV_ROUND_UP((int64_t) timeout * TIMER_FREQ, 1000);
+  int ready, i;
+
+  if (nfds < 0 || nfds > POLL_MAX)
+    return -1;
+  b = malloc(sizeof *b);
+  if (b == NULL)
+    return -1;
+  fds = b->fds;
+  if (!copy_from_user(fds, ufds, nfds * sizeof *fds)) {
+    free(b);
+    kill_process();
+  }
+
+  /* Register on every wait queue before checking, so that no
+     wakeup between a check and sema_down() is lost. */
+  sema_init(&wakeup, 0);
+  for (i = 0; i < nfds; i++) {
+    struct waitq *q;
+    poll_fd(fds[i].fd, 0, &q);
+    b->waiting[i] = q != NULL;
+    if (b->waiting[i])
+      waitq_add(q, &b->entries[i], &wakeup);
+  }
+  if (timeout > 0)
+    timer_alarm(&alarm, &wakeup, ticks);
+
+  for (;;) {
+    ready = 0;
+    for (i = 0; i < nfds; i++) {
+      struct waitq *q;
+      fds[i].revents = poll_fd(fds[i].fd, fds[i].events, &q);
+      if (fds[i].revents != 0)
+        ready++;
+    }
+    if (ready > 0 || timeout == 0
+        || (timeout > 0 && timer_elapsed(start) >= ticks))
+      break;
+    sema_down(&wakeup);
+  }
+
+  if (timeout > 0)
+    timer_cancel(&alarm);
+  for (i = 0; i < nfds; i++)
+    if (b->waiting[i])
+      waitq_remove(&b->entries[i]);
+
+  if (!copy_to_user(ufds, fds, nfds * sizeof *fds)) {
+    free(b);
+    kill_process();
+  }
+  free(b);
+  return ready;
+}
+
+/* Starts an asynchronous read (if WRITE is false) or write of
+   SIZE bytes between user buffer BUF and byte offset OFS in the
+   file open as FD.  The data to write is copied in right away;
+   data read is copied out by aio_wait.  Returns the request's
+   identifier, or -1 on failure. */
+static int
+aio_start( int fd, bool write, uint8_t *buf, unsigned int size, off_t ofs )
+{
+  void *kbuf;
+  int id;
+
+  if(!is_user_range(buf, size))
+    kill_process();
+
+  /* File descriptors 0 & 1 are reserved for console. Skip those.*/
+  fd -= 2;
+  if (!valid_fd(fd) || ofs < 0 || size > AIO_MAX_SIZE
+      || file_is_pipe(thread_current()->files[fd]))
+    return -1;
+
+  kbuf = malloc(size > 0 ? size : 1);
+  if (kbuf == NULL)
+    return -1;
+  if (write && !copy_from_user(kbuf, buf, size)) {
+    free(kbuf);
+    kill_process();
+  }
+  id = aio_submit(thread_current()->files[fd], write, kbuf, size, ofs, buf);
+  if (id < 0)
+    free(kbuf);
+  return id;
+}
+
+/* Execute system call aio_read. */
+static int
+aio_read( int fd, uint8_t *buf, unsigned int size, off_t ofs )
+{
+  return aio_start(fd, false, buf, size, ofs);
+}
+
+/* Execute system call aio_write. */
+static int
+aio_write( int fd, const uint8_t *buf, unsigned int size, off_t ofs )
+{
+  return aio_start(fd, true, (uint8_t *) buf, size, ofs);
+}
+
+/* Execute system call aio_wait.  Waits for request ID, copies
+   out the data if it was a read, and returns the number of bytes
+   transferred, or -1 if the request failed or ID is not an
+   outstanding request. */
+static int
+aio_wait( int id )
+{
+  void *kbuf, *ubuf;
+  int result;
+
+  if (!aio_complete(id, &result, &kbuf, &ubuf))
+    return -1;
+  if (result > 0 && !copy_to_user(ubuf, kbuf, result)) {
+    free(kbuf);
+    kill_process();
+  }
+  free(kbuf);
+  return result;
+}
+
+/* Most pages in the kernel buffer that readv and writev gather
+   into.  Vectors up to this size are read or written in a single
+   file_read() or file_write(), and so atomically. */
+#define IOV_BUF_PAGES 16
+
+/* Allocates a kernel buffer for a vector of TOTAL bytes, which
+   must be positive: enough whole pages to hold it, but at most
+   IOV_BUF_PAGES.  Stores the number of pages into *PAGE_CNT.
+   Returns a null pointer if that many contiguous pages are not
+   free.  A smaller buffer would split the vector into several
+   writes, which another process could interleave with. */
+static uint8_t *
+get_iov_buf( int total, size_t *page_cnt )
+{
+  uint8_t *kbuf;
+
+  *page_cnt = DIV_ROUND_UP(total, PGSIZE);
+  if (*page_cnt > IOV_BUF_PAGES)
+    *page_cnt = IOV_BUF_PAGES;
+  return palloc_get_multiple(0, *page_cnt);
+}
+
+/* Copies the IOVCNT buffer descriptors at user address UIOV into
+   IOV, killing the process if they, or any of the buffers they
+   describe, are not valid user memory.  Returns the total length
+   of the buffers, or -1 if IOVCNT is out of range or the total
+   does not fit in an int. */
+static int
+get_iovec( struct iovec iov[IOV_MAX], const struct iovec *uiov, int iovcnt )
+{
+  unsigned int total = 0;
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  if (!copy_from_user(iov, uiov, iovcnt * sizeof *iov))
+    kill_process();
+  for (i = 0; i < iovcnt; i++) {
+    if (!is_user_range(iov[i].iov_base, iov[i].iov_len))
+      kill_process();
+    total += iov[i].iov_len;
+    if (total > INT_MAX || total < iov[i].iov_len)
+      return -1;
   }
+  return total;
+}
+
+/* Copies SIZE bytes between KBUF and the bytes of the buffers in
+   IOV that start OFS bytes into the vector, to the buffers if
+   TO_USER is true, from them otherwise.  Returns true if
+   successful, false if a buffer turned out not to be mapped. */
+static bool
+copy_iovec( const struct iovec *iov, unsigned int ofs, uint8_t *kbuf,
+            unsigned int size, bool to_user )
+{
+  for (; size > 0; iov++) {
+    unsigned int chunk;
+    uint8_t *ubuf;
+
+    if (ofs >= iov->iov_len) {
+      ofs -= iov->iov_len;
+      continue;
+    }
+    ubuf = (uint8_t *) iov->iov_base + ofs;
+    chunk = iov->iov_len - ofs < size ? iov->iov_len - ofs : size;
+    if (to_user ? !copy_to_user(ubuf, kbuf, chunk)
+                : !copy_from_user(kbuf, ubuf, chunk))
+      return false;
+    kbuf += chunk;
+    size -= chunk;
+    ofs = 0;
+  }
+  return true;
+}
+
+/* Execute system call writev. */
+static int
+writev( int fd, const struct iovec *uiov, int iovcnt )
+{
+  struct iovec iov[IOV_MAX];
+  int total = get_iovec(iov, uiov, iovcnt);
+  struct file* f = NULL;
+  int done;
+  uint8_t* kbuf;
+  size_t page_cnt;
+  int buf_size;
+
+  if (total < 0)
+    return -1;
+  if (fd == STDIN_FILENO) {
+    return -1;
+  } else if (fd != STDOUT_FILENO) {
+    /* File descriptors 0 & 1 are reserved for console. Skip those.*/
+    fd -= 2;
+    if(!valid_fd(fd))
+      return -1;
+    f = thread_current()->files[fd];
+  }
+
+  /* Gather the buffers into one kernel buffer, so that the file
+     position and file system locks are taken once for the whole
+     vector and no user page is touched while they are held. */
+  if (total == 0)
+    return 0;
+  kbuf = get_iov_buf(total, &page_cnt);
+  if (kbuf == NULL)
+    return -1;
+  buf_size = page_cnt * PGSIZE;
+  for (done = 0; done < total; ) {
+    int chunk = total - done < buf_size ? total - done : buf_size;
+    int n;
+
+    if (!copy_iovec(iov, done, kbuf, chunk, false)) {
+      palloc_free_multiple(kbuf, page_cnt);
+      kill_process();
+    }
+    if (f == NULL) {
+      putbuf((const char *) kbuf, chunk);
+      n = chunk;
+    } else
+      n = file_write(f, kbuf, chunk);
+
+    if (n < 0) {
+      if (done == 0)
+        done = -1;
+      break;
+    }
+    done += n;
+    if (n < chunk)
+      break;
+  }
+  palloc_free_multiple(kbuf, page_cnt);
+  if (done > 0)
+    thread_current()->usage.write_bytes += done;
+  return done;
+}
+
+/* Execute system call readv. */
+static int
+readv( int fd, const struct iovec *uiov, int iovcnt )
+{
+  struct iovec iov[IOV_MAX];
+  int total = get_iovec(iov, uiov, iovcnt);
+  struct file* f = NULL;
+  int done;
+  uint8_t* kbuf;
+  size_t page_cnt;
+  int buf_size;
+
+  if (total < 0)
+    return -1;
+  if (fd == STDOUT_FILENO) {
+    return -1;
+  } else if (fd != STDIN_FILENO) {
+    /* File descriptors 0 & 1 are reserved for console. Skip those.*/
+    fd -= 2;
+    if(!valid_fd(fd))
+      return -1;
+    f = thread_current()->files[fd];
+  }
+
+  /* Read into one kernel buffer and scatter it, as in writev. */
+  if (total == 0)
+    return 0;
+  kbuf = get_iov_buf(total, &page_cnt);
+  if (kbuf == NULL)
+    return -1;
+  buf_size = page_cnt * PGSIZE;
+  for (done = 0; done < total; ) {
+    int chunk = total - done < buf_size ? total - done : buf_size;
+    int n;
+
+    if (f == NULL) {
+      for (n = 0; n < chunk; n++)
+        kbuf[n] = input_getc();
+    } else
+      n = file_read(f, kbuf, chunk);
+
+    if (n < 0) {
+      if (done == 0)
+        done = -1;
+      break;
+    }
+    if (n > 0 && !copy_iovec(iov, done, kbuf, n, true)) {
+      palloc_free_multiple(kbuf, page_cnt);
+      kill_process();
+    }
+    done += n;
+    /* A pipe returns whatever it has, as in read. */
+    if (n < chunk || (f != NULL && file_is_pipe(f)))
+      break;
+  }
+  palloc_free_multiple(kbuf, page_cnt);
+  if (done > 0)
+    thread_current()->usage.read_bytes += done;
+  return done;
 }
 
 /* Execute system call seek. */
 static void
-seek( void *esp )
+seek( int fd, unsigned position )
 {
-  /* Get arguments. */
-  int fd = get_argument(esp, 0);
-  unsigned position = get_argument(esp, 1);
   /* File descriptors 0 & 1 are reserved for console. Skip those.*/
   fd -= 2; 
   /* Control file descriptor. */
   if(!valid_fd(fd))
-    return -1;
+    return;
 
   struct file* f = thread_current()->files[fd];
   file_seek(f, position);
@@ -226,10 +803,8 @@ seek( void *esp )
 
 /* Execute system call tell. */
 static unsigned
-tell( void *esp )
+tell( int fd )
 {
-  /* Get arguments. */
-  int fd = get_argument(esp, 0);
   /* File descriptors 0 & 1 are reserved for console. Skip those.*/
   fd -= 2; 
   /* Control file descriptor. */
@@ -245,8 +820,7 @@ tell( void *esp )
 
 /* Execute system call filesize. */
 static int
-filesize( void *esp ){
-  int fd = get_argument(esp, 0);
+filesize( int fd ){
   /* File descriptors 0 & 1 are reserved for console. Skip those.*/
   fd -= 2; 
   /* Control file descriptor. */
@@ -260,14 +834,14 @@ filesize( void *esp ){
   return size;
 }
 
-/* Execute system call close. */
+/* Execute system call remove. */
 static bool
-remove( void *esp )
+remove( const char *uname )
 {
-  /* Get arguments. */
-  const char* name = get_argument(esp, 0);
+  char name[NAME_BUF_SIZE];
 
-  validate_pointer(name, 14); // Maximum of 14 chars in file name.
+  if (!get_file_name(name, uname))
+    return false;
 
   bool success = false;
   success = filesys_remove(name);
@@ -277,10 +851,10 @@ remove( void *esp )
 
 /* Execute system call close. */
 static void
-close( void *esp )
+close( int fd )
 {
-  /* Get arguments. */
-  int fd = get_argument(esp, 0) - 2;
+  /* File descriptors 0 & 1 are reserved for console. Skip those.*/
+  fd -= 2;
 
   /* Validate file descriptor. */
   if(!valid_fd(fd)) return;
@@ -296,117 +870,482 @@ close( void *esp )
 
 /* Execute system call execute. */
 static int
-exec( void* esp )
+exec( const char *ucmd_line )
 {
-  const char* cmd_line = get_argument(esp, 0);
-  validate_pointer(cmd_line, 1); 
-  int pid = process_execute(cmd_line);
+  char *cmd_line = palloc_get_page(0);
+  int len, pid;
+
+  if (cmd_line == NULL)
+    return -1;
+  len = strncpy_from_user(cmd_line, ucmd_line, PGSIZE);
+  if (len < 0) {
+    palloc_free_page(cmd_line);
+    kill_process();
+  }
+  if (len == PGSIZE) {
+    palloc_free_page(cmd_line);
+    return -1;
+  }
+  pid = process_execute(cmd_line);
+  palloc_free_page(cmd_line);
   return pid;
 }
 
+/* Execute system call spawn: starts the program named UPATH with
+   the arguments in the null-terminated array UARGV, which are
+   copied straight into the new process's argument block.  Unless
+   FLAGS includes SPAWN_NOWAIT, waits for the program to load.
+   Returns the new process's pid, or -1 on failure. */
 static int
-wait( void* esp)
+spawn( const char *upath, char *const *uargv, int flags )
+{
+  struct exec_args *args = exec_args_create();
+  int len;
+
+  if (args == NULL)
+    return -1;
+  len = strncpy_from_user(args->file_name, upath, sizeof args->file_name);
+  if (len < 0) {
+    palloc_free_page(args);
+    kill_process();
+  }
+  if (len == sizeof args->file_name) {
+    palloc_free_page(args);
+    return -1;
+  }
+
+  for (;;) {
+    size_t avail = sizeof args->strings - args->size;
+    const char *uarg;
+
+    if (!copy_from_user(&uarg, uargv + args->argc, sizeof uarg)) {
+      palloc_free_page(args);
+      kill_process();
+    }
+    if (uarg == NULL)
+      break;
+    if (args->argc == EXEC_ARGS_MAX) {
+      palloc_free_page(args);
+      return -1;
+    }
+    len = strncpy_from_user(args->strings + args->size, uarg, avail);
+    if (len < 0) {
+      palloc_free_page(args);
+      kill_process();
+    }
+    if ((size_t) len == avail) {
+      palloc_free_page(args);
+      return -1;
+    }
+    args->size += len + 1;
+    args->argc++;
+  }
+  return process_spawn(args, !(flags & SPAWN_NOWAIT));
+}
+
+/* Execute system call wait. */
+static int
+wait( int pid )
 {
-  int pid = get_argument(esp, 0);
   int exit_status = process_wait(pid);
   return exit_status;
 }
 
 
+/* Execute system call waitpid: waits for child PID, or any child
+   if PID is -1, and stores its exit status in *USTATUS unless
+   USTATUS is null.  Returns the child's pid, 0 if OPTIONS has
+   WNOHANG and no such child has exited yet, or -1 if there is no
+   such child. */
+static int
+waitpid( int pid, int *ustatus, int options )
+{
+  int status;
+  tid_t tid;
+
+  if (ustatus != NULL && !is_user_range(ustatus, sizeof *ustatus))
+    kill_process();
+  if (pid < -1 || options & ~WNOHANG)
+    return -1;
+
+  tid = process_waitpid(pid, &status, options);
+  if (tid > 0 && ustatus != NULL
+      && !copy_to_user(ustatus, &status, sizeof status))
+    kill_process();
+  return tid;
+}
+
+/* Execute system call getrusage: stores the resource usage of
+   the calling process, or of its children if WHO is
+   RUSAGE_CHILDREN, into *UUSAGE.  Returns 0 if successful, -1 if
+   WHO is invalid. */
+static int
+getrusage( int who, struct rusage *uusage )
+{
+  struct rusage usage;
+
+  if (who != RUSAGE_SELF && who != RUSAGE_CHILDREN)
+    return -1;
+  process_get_rusage(who, &usage);
+  if (!copy_to_user(uusage, &usage, sizeof usage))
+    kill_process();
+  return 0;
+}
+
+/* Execute system call sysenter: returns true if the process may
+   enter the kernel with SYSENTER instead of "int $0x30". */
+static bool
+sysenter( void )
+{
+  return tss_has_sysenter();
+}
+
 /* Execute system call exit. */
 static void
-exit( void* esp )
+exit( int status )
 {
-  int status = get_argument(esp, 0);
   /* Set exit code. */
   thread_current()->exit_status = status;
   /* Exit process. */
   thread_exit();
 }
 
-static void
-syscall_handler (struct intr_frame *f UNUSED) 
+/* Execute system call ring_setup.  The ring is an ordinary user
+   page mapped straight into the page directory, outside the
+   supplemental page table, so it is never evicted and the kernel
+   may use it through its kernel address at any time.  It is freed
+   with the page directory, and is not inherited by fork(). */
+static struct ring *
+ring_setup( void )
 {
-  /* Get syscall number from stack. */
-  int* esp = f->esp;
-  
-  /* Check so pointers aren't in kernel memory. */
-  if(!is_user_vaddr(esp) || !is_user_vaddr(esp + 1) || !is_user_vaddr(esp + 2) || !is_user_vaddr(esp + 3)) {
-    /* Exit process. */
-    thread_current()->exit_status = -1;
-    thread_exit();
-  }
-  
-  if(get_user(esp) == -1 || get_user(esp + 1) == -1 || get_user(esp + 2) == -1 || get_user(esp + 3) == -1){
-    /* Exit process. */
-    thread_current()->exit_status = -1;
-    thread_exit();
+  struct thread *t = thread_current();
+  struct ring *ring;
+
+  if (t->ring != NULL)
+    return RING_UPAGE;
+  if (pagedir_get_page(t->pagedir, RING_UPAGE) != NULL)
+    return NULL;
+#ifdef VM
+  if (page_lookup(RING_UPAGE) != NULL)
+    return NULL;
+#endif
+
+  ring = palloc_get_page(PAL_USER | PAL_ZERO);
+  if (ring == NULL)
+    return NULL;
+  if (!pagedir_set_page(t->pagedir, RING_UPAGE, ring, true)) {
+    palloc_free_page(ring);
+    return NULL;
   }
-    
-  if(*esp < SYS_HALT || *esp > SYS_REMOVE) {
-    /* Exit process. */
-    thread_current()->exit_status = -1;
-    thread_exit();
+  t->ring = ring;
+  return RING_UPAGE;
+}
+
+/* Carries out operation SQE, which the process may not trust, and
+   returns its result.  Bad pointers in SQE kill the process, just
+   as they would in the corresponding system call. */
+static int
+ring_execute( const struct ring_sqe *sqe )
+{
+  switch (sqe->op) {
+    case RING_OP_NOP:
+      return 0;
+    case RING_OP_OPEN:
+      return open(sqe->buf);
+    case RING_OP_CLOSE:
+      close(sqe->fd);
+      return 0;
+    case RING_OP_READ:
+      return read(sqe->fd, sqe->buf, sqe->len, -1);
+    case RING_OP_WRITE:
+      return write(sqe->fd, sqe->buf, sqe->len, -1);
+    case RING_OP_PREAD:
+      return pread(sqe->fd, sqe->buf, sqe->len, sqe->offset);
+    case RING_OP_PWRITE:
+      return pwrite(sqe->fd, sqe->buf, sqe->len, sqe->offset);
+    default:
+      return -1;
   }
-  
-  int sys_nr = *esp;
-  switch(sys_nr) {
-    case SYS_HALT: // Shutdown machine
-      halt();
-      NOT_REACHED();
-      break;
+}
 
-    case SYS_CREATE: // Create a file with specified size.
-      f->eax = create(esp);
-      break;
+/* Execute system call ring_enter.  Consumes up to TO_SUBMIT
+   submissions from the current process's ring, in order, posting
+   a completion for each.  Stops early when the submission ring is
+   empty or the completion ring is full.  Returns the number of
+   submissions consumed, or -1 if there is no ring.
 
-    case SYS_OPEN: // If possible open file.
-      f->eax = open(esp); 
-      break;
+   Operations are carried out as they are consumed, so all of them
+   are complete when this returns and MIN_COMPLETE, the number of
+   completions to wait for, never causes a wait. */
+static int
+ring_enter( unsigned int to_submit, unsigned int min_complete UNUSED )
+{
+  struct ring *ring = thread_current()->ring;
+  unsigned int done;
 
-    case SYS_WRITE: // Write to file or consol.
-      f->eax = write(esp);
-      break;
+  if (ring == NULL)
+    return -1;
 
-    case SYS_READ: // Read from file or console.
-      f->eax = read(esp);
-      break;
+  for (done = 0; done < to_submit && ring->sq_head != ring->sq_tail; done++) {
+    struct ring_sqe sqe;
+    struct ring_cqe *cqe;
 
-    case SYS_SEEK:  // Seek to a position in a file.
-      seek(esp);
+    if (ring->cq_tail - ring->cq_head >= RING_ENTRIES)
       break;
 
-    case SYS_TELL:  // Tell a position in a file.
-      f->eax = tell(esp);
-      break;
+    /* Copy the submission so that the process cannot change it
+       while we use it. */
+    sqe = ring->sq[ring->sq_head % RING_ENTRIES];
+    ring->sq_head++;
 
-    case SYS_FILESIZE:  // Get size of a file.
-      f->eax = filesize(esp);
-      break;
+    cqe = &ring->cq[ring->cq_tail % RING_ENTRIES];
+    cqe->user_data = sqe.user_data;
+    cqe->result = ring_execute(&sqe);
+    ring->cq_tail++;
+  }
+  return done;
+}
 
-    case SYS_REMOVE:  // Remove a file from file system.
-      f->eax = remove(esp);
-      break;
+#ifdef VM
+/* Execute system call mmap. */
+static mapid_t
+mmap( int fd, void *addr )
+{
+  /* File descriptors 0 & 1 are reserved for console. Skip those.*/
+  fd -= 2; 
+  /* Control file descriptor. */
+  if(!valid_fd(fd))
+    return MAP_FAILED;
 
-    case SYS_CLOSE: // Close file.
-      close(esp);
-      break;
+  return mmap_create(thread_current()->files[fd], addr);
+}
 
-    case SYS_EXEC: // Start a process
-      f->eax = exec(esp);
-      break;
+/* Execute system call munmap. */
+static void
+munmap( mapid_t mapping )
+{
+  mmap_destroy(mapping);
+}
 
-    case SYS_WAIT:
-      f->eax = wait(esp);
-      break;
+/* Execute system call memstat. */
+static void
+memstat( struct memstat *uusage )
+{
+  struct memstat usage;
 
-    case SYS_EXIT: // Exit process.
-      exit(esp);
-      break;
+  frame_get_usage(&usage);
+  if(!copy_to_user(uusage, &usage, sizeof usage))
+    kill_process();
+}
 
-    default: 
-      printf ("Unknown system call %d\n", sys_nr);
-      thread_exit ();
-  }
+/* Execute system call memlimit. */
+static int
+memlimit( int limit )
+{
+  int old_limit = thread_current()->rss_limit;
+
+  if(limit < 0)
+    return -1;
+  frame_set_limit(limit);
+  return old_limit;
+}
+#endif
+
+
+/* Most arguments any system call takes. */
+#define SYSCALL_ARGS_MAX 4
+
+/* A system call stub, which passes the arguments ARG copied from
+   the user stack to the system call's handler with their proper
+   types, and returns the value to pass back to the user program. */
+typedef uint32_t syscall_func (struct intr_frame *f, const uint32_t *arg);
+
+/* Defines stub sys_NAME(), which returns the value of CALL. */
+#define STUB(NAME, CALL)                                              \
+        static uint32_t                                               \
+        sys_##NAME (struct intr_frame *f UNUSED,                      \
+                    const uint32_t *arg UNUSED)                       \
+        {                                                             \
+          return CALL;                                                \
+        }
+
+/* Defines stub sys_NAME() for a handler that returns nothing. */
+#define VOID_STUB(NAME, CALL)                                         \
+        static uint32_t                                               \
+        sys_##NAME (struct intr_frame *f UNUSED,                      \
+                    const uint32_t *arg UNUSED)                       \
+        {                                                             \
+          CALL;                                                       \
+          return 0;                                                   \
+        }
+
+VOID_STUB (halt, halt ())
+VOID_STUB (exit, exit (arg[0]))
+STUB (exec, exec ((const char *) arg[0]))
+STUB (wait, wait (arg[0]))
+STUB (create, create ((const char *) arg[0], arg[1]))
+STUB (read, read (arg[0], (uint8_t *) arg[1], arg[2], -1))
+STUB (write, write (arg[0], (const uint8_t *) arg[1], arg[2], -1))
+STUB (open, open ((const char *) arg[0]))
+VOID_STUB (close, close (arg[0]))
+STUB (filesize, filesize (arg[0]))
+VOID_STUB (seek, seek (arg[0], arg[1]))
+STUB (tell, tell (arg[0]))
+STUB (remove, remove ((const char *) arg[0]))
+STUB (readv, readv (arg[0], (const struct iovec *) arg[1], arg[2]))
+STUB (writev, writev (arg[0], (const struct iovec *) arg[1], arg[2]))
+STUB (pread, pread (arg[0], (uint8_t *) arg[1], arg[2], arg[3]))
+STUB (pwrite, pwrite (arg[0], (const uint8_t *) arg[1], arg[2], arg[3]))
+STUB (ring_setup, (uint32_t) ring_setup ())
+STUB (ring_enter, ring_enter (arg[0], arg[1]))
+STUB (aio_read, aio_read (arg[0], (uint8_t *) arg[1], arg[2], arg[3]))
+STUB (aio_write, aio_write (arg[0], (const uint8_t *) arg[1], arg[2], arg[3]))
+STUB (aio_wait, aio_wait (arg[0]))
+STUB (copy_file_range, copy_file_range (arg[0], arg[1], arg[2]))
+STUB (poll, poll ((struct pollfd *) arg[0], arg[1], arg[2]))
+STUB (pipe, pipe ((int *) arg[0]))
+STUB (shm_create, (uint32_t) shm_create (arg[0], arg[1]))
+STUB (shm_attach, (uint32_t) shm_attach (arg[0]))
+STUB (shm_detach, shm_detach ((void *) arg[0]))
+STUB (futex_wait, shm_wait ((const int *) arg[0], arg[1]))
+STUB (futex_wake, shm_wake ((const int *) arg[0], arg[1]))
+STUB (spawn, spawn ((const char *) arg[0], (char *const *) arg[1], arg[2]))
+STUB (waitpid, waitpid (arg[0], (int *) arg[1], arg[2]))
+STUB (getrusage, getrusage (arg[0], (struct rusage *) arg[1]))
+STUB (sysenter, sysenter ())
+#ifdef VM
+STUB (mmap, mmap (arg[0], (void *) arg[1]))
+VOID_STUB (munmap, munmap (arg[0]))
+STUB (fork, process_fork (f))
+VOID_STUB (memstat, memstat ((struct memstat *) arg[0]))
+STUB (memlimit, memlimit (arg[0]))
+#endif
+
+/* Argument N of a system call is a user pointer.  The system call
+   handler rejects kernel addresses before calling the stub. */
+#define PTR_ARG(N) (1u << (N))
+
+/* A system call. */
+struct syscall
+  {
+    const char *name;           /* Name, for statistics. */
+    syscall_func *func;         /* Stub, or null if not supported. */
+    int arg_cnt;                /* Number of arguments. */
+    unsigned ptr_args;          /* PTR_ARG bits. */
+  };
+
+#define SYSCALL(NAME, ARG_CNT, PTR_ARGS) \
+        { #NAME, sys_##NAME, ARG_CNT, PTR_ARGS }
+
+/* System calls, indexed by number. */
+static const struct syscall syscalls[] =
+  {
+    [SYS_HALT] = SYSCALL (halt, 0, 0),
+    [SYS_EXIT] = SYSCALL (exit, 1, 0),
+    [SYS_EXEC] = SYSCALL (exec, 1, PTR_ARG (0)),
+    [SYS_WAIT] = SYSCALL (wait, 1, 0),
+    [SYS_CREATE] = SYSCALL (create, 2, PTR_ARG (0)),
+    [SYS_READ] = SYSCALL (read, 3, PTR_ARG (1)),
+    [SYS_WRITE] = SYSCALL (write, 3, PTR_ARG (1)),
+    [SYS_OPEN] = SYSCALL (open, 1, PTR_ARG (0)),
+    [SYS_CLOSE] = SYSCALL (close, 1, 0),
+    [SYS_FILESIZE] = SYSCALL (filesize, 1, 0),
+    [SYS_SEEK] = SYSCALL (seek, 2, 0),
+    [SYS_TELL] = SYSCALL (tell, 1, 0),
+    [SYS_REMOVE] = SYSCALL (remove, 1, PTR_ARG (0)),
+    [SYS_READV] = SYSCALL (readv, 3, PTR_ARG (1)),
+    [SYS_WRITEV] = SYSCALL (writev, 3, PTR_ARG (1)),
+    [SYS_PREAD] = SYSCALL (pread, 4, PTR_ARG (1)),
+    [SYS_PWRITE] = SYSCALL (pwrite, 4, PTR_ARG (1)),
+    [SYS_RING_SETUP] = SYSCALL (ring_setup, 0, 0),
+    [SYS_RING_ENTER] = SYSCALL (ring_enter, 2, 0),
+    [SYS_AIO_READ] = SYSCALL (aio_read, 4, PTR_ARG (1)),
+    [SYS_AIO_WRITE] = SYSCALL (aio_write, 4, PTR_ARG (1)),
+    [SYS_AIO_WAIT] = SYSCALL (aio_wait, 1, 0),
+    [SYS_COPY_FILE_RANGE] = SYSCALL (copy_file_range, 3, 0),
+    [SYS_POLL] = SYSCALL (poll, 3, PTR_ARG (0)),
+    [SYS_PIPE] = SYSCALL (pipe, 1, PTR_ARG (0)),
+    [SYS_SHM_CREATE] = SYSCALL (shm_create, 2, 0),
+    [SYS_SHM_ATTACH] = SYSCALL (shm_attach, 1, 0),
+    [SYS_SHM_DETACH] = SYSCALL (shm_detach, 1, 0),
+    [SYS_FUTEX_WAIT] = SYSCALL (futex_wait, 2, 0),
+    [SYS_FUTEX_WAKE] = SYSCALL (futex_wake, 2, 0),
+    [SYS_SPAWN] = SYSCALL (spawn, 3, PTR_ARG (0) | PTR_ARG (1)),
+    [SYS_WAITPID] = SYSCALL (waitpid, 3, PTR_ARG (1)),
+    [SYS_GETRUSAGE] = SYSCALL (getrusage, 2, PTR_ARG (1)),
+    [SYS_SYSENTER] = SYSCALL (sysenter, 0, 0),
+#ifdef VM
+    [SYS_MMAP] = SYSCALL (mmap, 2, 0),
+    [SYS_MUNMAP] = SYSCALL (munmap, 1, 0),
+    [SYS_FORK] = SYSCALL (fork, 0, 0),
+    [SYS_MEMSTAT] = SYSCALL (memstat, 1, PTR_ARG (0)),
+    [SYS_MEMLIMIT] = SYSCALL (memlimit, 1, 0),
+#endif
+  };
+
+/* Number of entries in syscalls[]. */
+#define SYSCALL_CNT (sizeof syscalls / sizeof *syscalls)
+
+/* Statistics for each system call. */
+struct syscall_stats
+  {
+    long long calls;            /* Number of calls. */
+    long long cycles;           /* CPU cycles spent in calls that returned. */
+  };
+static struct syscall_stats stats[SYSCALL_CNT];
+
+/* Handles the system call whose number and arguments are on the
+   user stack described by F, entered through "int $0x30" or
+   sysenter_entry. */
+void
+syscall_handler (struct intr_frame *f)
+{
+  const struct syscall *sc;
+  uint32_t args[SYSCALL_ARGS_MAX] = { 0, 0, 0, 0 };
+  uint32_t *esp = f->esp;
+  uint32_t nr;
+  uint64_t start;
+  int i;
+
+#ifdef VM
+  /* Remember the user stack pointer for stack growth on page
+     faults taken while in the kernel. */
+  thread_current ()->user_esp = f->esp;
+#endif
+
+  /* Fetch the system call number, then all of its arguments in
+     a single copy, so that handlers need not check them again. */
+  if (!copy_from_user (&nr, esp, sizeof nr) || nr >= SYSCALL_CNT)
+    kill_process ();
+  sc = &syscalls[nr];
+  if (sc->func == NULL)
+    {
+      printf ("Unknown system call %d\n", (int) nr);
+      kill_process ();
+    }
+  if (!copy_from_user (args, esp + 1, sc->arg_cnt * sizeof *args))
+    kill_process ();
+  for (i = 0; i < sc->arg_cnt; i++)
+    if ((sc->ptr_args & PTR_ARG (i)) && !is_user_vaddr ((void *) args[i]))
+      kill_process ();
+
+  stats[nr].calls++;
+  thread_current ()->usage.syscalls++;
+  start = rdtsc ();
+  f->eax = sc->func (f, args);
+  stats[nr].cycles += rdtsc () - start;
+}
+
+/* Prints the number of calls to, and average CPU cycles spent in,
+   each system call that was used. */
+void
+syscall_print_stats (void)
+{
+  size_t nr;
 
+  for (nr = 0; nr < SYSCALL_CNT; nr++)
+    if (stats[nr].calls > 0)
+      printf ("Syscall %s: %lld calls, %lld cycles/call\n",
+              syscalls[nr].name, stats[nr].calls,
+              stats[nr].cycles / stats[nr].calls);
 }
@@ -1,8 +1,15 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include "threads/interrupt.h"
+
 #define CONSOLE_BUFFER_SIZE 150
 
 void syscall_init (void);
+void syscall_handler (struct intr_frame *);
+void syscall_print_stats (void);
+
+/* Fast system call entry point, in userprog/sysenter.S. */
+void sysenter_entry (void);
 
 #endif /* userprog/syscall.h */
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "threads/thread.h"
@@ -75,6 +76,28 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* Model-specific registers that control SYSENTER and SYSEXIT.
+   See [IA32-v2b] "SYSENTER--Fast System Call". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Stack that SYSENTER switches to.  Its top word holds a copy
+   of the TSS's esp0, kept up to date by tss_update(), from which
+   sysenter_entry loads the thread's kernel stack pointer.  The
+   rest is only used by a debug exception taken before that, when
+   a user program executes SYSENTER with the trap flag set (see
+   userprog/exception.c). */
+#define SYSENTER_STACK_WORDS 256
+static uint32_t sysenter_stack[SYSENTER_STACK_WORDS];
+#define SYSENTER_ESP0 (sysenter_stack[SYSENTER_STACK_WORDS - 1])
+
+/* True if SYSENTER is set up. */
+static bool sysenter_enabled;
+
+static bool cpu_has_sysenter (void);
+static void wrmsr (uint32_t msr, uint32_t value);
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -86,6 +109,18 @@ tss_init (void)
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
   tss_update ();
+
+  /* SYSENTER loads %esp from an MSR, not from the TSS.  Rather
+     than rewriting the MSR on every thread switch, point it at
+     the top of sysenter_stack, from which sysenter_entry loads the
+     real stack pointer. */
+  if (cpu_has_sysenter ())
+    {
+      wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+      wrmsr (MSR_SYSENTER_ESP, (uint32_t) &SYSENTER_ESP0);
+      wrmsr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+      sysenter_enabled = true;
+    }
 }
 
 /* Returns the kernel TSS. */
@@ -103,4 +138,37 @@ tss_update (void)
 {
   ASSERT (tss != NULL);
   tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
+  SYSENTER_ESP0 = (uint32_t) tss->esp0;
+}
+
+/* Returns true if user programs may enter the kernel with
+   SYSENTER. */
+bool
+tss_has_sysenter (void)
+{
+  return sysenter_enabled;
+}
+
+/* Returns true if the CPU supports SYSENTER and SYSEXIT.  The
+   earliest Pentium Pro models set the SEP flag in CPUID but do
+   not actually support the instructions. */
+static bool
+cpu_has_sysenter (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0));
+  if (eax < 1)
+    return false;
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if (((eax >> 8) & 0xf) == 6 && ((eax >> 4) & 0xf) < 3 && (eax & 0xf) < 3)
+    return false;
+  return (edx & (1 << 11)) != 0;
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static void
+wrmsr (uint32_t msr, uint32_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
 }
@@ -0,0 +1,741 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+
+/* Frame table.
+
+   Every user pool frame that holds a user page is recorded in
+   FRAMES.  When the user pool runs dry, frame_alloc() picks a
+   victim with the second-chance ("clock") algorithm, writes it
+   out with evict_pages() and hands the frame over to the new page
+   instead of failing.
+
+   A frame normally holds the page of a single process, but after
+   a fork it holds the same page for parent and child, mapped
+   read-only in both, until frame_unshare() gives a writer its own
+   copy.  All the pages sharing a frame also share its swap slot,
+   if any.
+
+   Read-only pages of executables are shared as well: every such
+   page that is resident is recorded in TEXT_CACHE, keyed by the
+   executable's inode and the page's user address, and another
+   process running the same executable maps that frame instead
+   of reading the page again.  A frame leaves the cache when it
+   is evicted or its last page goes away.  Running executables
+   cannot be written, so cached frames never go stale.
+
+   FRAME_LOCK must be held to change the frame table or to move
+   a page in or out of a frame.  evict_pages() releases it while
+   it writes a frame to swap, so that other processes need not
+   wait for the disk, but marks the frame as being evicted
+   meanwhile: the clock passes it over, and its pages cannot be
+   faulted back in or destroyed until the write is done (see
+   wait_for_eviction()).
+
+   Each process's RSS counts the pages it has in frames, shared
+   or not.  A process may set a limit on its RSS (see
+   frame_set_limit()); once it reaches the limit, frame_alloc()
+   makes room by evicting one of the process's own pages rather
+   than taking a frame that other processes could use. */
+static struct list frames;
+static size_t frame_cnt;                /* Number of elements in FRAMES. */
+static struct list_elem *clock_hand;    /* Next frame the clock looks at. */
+static struct lock frame_lock;
+static struct condition evict_done;     /* Signaled when an eviction ends. */
+static struct hash text_cache;          /* Shared executable pages. */
+
+/* Statistics. */
+static long long alloc_cnt;     /* # of frames handed out. */
+static long long evict_cnt;     /* # of those obtained by eviction. */
+static long long share_cnt;     /* # of pages shared by fork. */
+static long long copy_cnt;      /* # of shared pages copied on write. */
+static long long text_cnt;      /* # of executable pages found cached. */
+static long long limit_cnt;     /* # of frames reclaimed over RSS limit. */
+
+static struct frame *get_frame (void);
+static struct frame *frame_evict (void);
+static struct frame *frame_evict_own (struct thread *);
+static void add_page (struct frame *, struct page *);
+static void remove_page (struct page *);
+static void release_frame (struct frame *);
+static void free_frame (struct frame *);
+static void wait_for_eviction (struct page *);
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  list_init (&frames);
+  frame_cnt = 0;
+  clock_hand = list_end (&frames);
+  lock_init (&frame_lock);
+  cond_init (&evict_done);
+  hash_init (&text_cache, text_hash, text_less, NULL);
+}
+
+/* Obtains a frame for PAGE, evicting another page if the user
+   pool is exhausted.  If PAGE itself is still being written to
+   swap, waits for that to finish first.  PAGE is returned
+   pinned; call frame_unpin() once it has been installed.
+   Returns a null pointer if no frame could be obtained. */
+struct frame *
+frame_alloc (struct page *page)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (page);
+  ASSERT (page->frame == NULL);
+
+  f = NULL;
+  if (page->owner->rss_limit > 0
+      && page->owner->rss >= page->owner->rss_limit)
+    {
+      f = frame_evict_own (page->owner);
+      if (f != NULL)
+        alloc_cnt++;
+    }
+  if (f == NULL)
+    f = get_frame ();
+  if (f != NULL)
+    {
+      add_page (f, page);
+      page->pinned = true;
+    }
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Unmaps PAGE and releases the frame that holds it, if any.  The
+   frame itself is freed once no other page shares it. */
+void
+frame_free (struct page *page)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (page);
+  f = page->frame;
+  if (f != NULL)
+    {
+      pagedir_clear_page (page->owner->pagedir, page->upage);
+      remove_page (page);
+      if (list_empty (&f->pages))
+        free_frame (f);
+    }
+  lock_release (&frame_lock);
+}
+
+/* If another process has the executable page P resident, maps P
+   to the same frame and pins P, just like page_in().
+   Returns true if successful, false if P must be read in. */
+bool
+frame_share_text (struct page *p)
+{
+  struct frame key;
+  struct hash_elem *e;
+  struct frame *f = NULL;
+
+  ASSERT (p->file != NULL && !p->writable);
+
+  key.inode = file_get_inode (p->file);
+  key.upage = p->upage;
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (p);
+  ASSERT (p->frame == NULL);
+  e = hash_find (&text_cache, &key.text_elem);
+  if (e != NULL)
+    {
+      f = hash_entry (e, struct frame, text_elem);
+      if (pagedir_set_page (p->owner->pagedir, p->upage, f->kpage, false))
+        {
+          add_page (f, p);
+          p->pinned = true;
+          text_cnt++;
+        }
+      else
+        f = NULL;
+    }
+  lock_release (&frame_lock);
+
+  return f != NULL;
+}
+
+/* Offers executable page P, which has just been read into its
+   own frame, to other processes running the same executable. */
+void
+frame_cache_text (struct page *p)
+{
+  struct frame *f;
+
+  ASSERT (p->file != NULL && !p->writable);
+
+  lock_acquire (&frame_lock);
+  f = p->frame;
+  if (f != NULL && f->inode == NULL)
+    {
+      f->inode = file_get_inode (p->file);
+      f->upage = p->upage;
+
+      /* If another process got there first, keep ours private. */
+      if (hash_insert (&text_cache, &f->text_elem) != NULL)
+        f->inode = NULL;
+    }
+  lock_release (&frame_lock);
+}
+
+/* Makes page DST, of a newly forked process, a copy of page SRC
+   of its parent without copying any data: if SRC is resident,
+   DST shares its frame and both are mapped read-only, otherwise
+   DST shares SRC's swap slot, if any.
+   Returns true if successful, false if memory allocation
+   fails. */
+bool
+frame_share (struct page *src, struct page *dst)
+{
+  struct frame *f;
+  bool success = true;
+
+  ASSERT (dst->frame == NULL && dst->swap_slot == SWAP_NONE);
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (src);
+  f = src->frame;
+  if (f != NULL && page_is_dirty (src) && src->swap_slot != SWAP_NONE)
+    {
+      /* The swap copy is stale and must not be shared. */
+      swap_free (src->swap_slot);
+      src->swap_slot = SWAP_NONE;
+    }
+
+  if (f != NULL)
+    {
+      success = pagedir_set_page (dst->owner->pagedir, dst->upage,
+                                  f->kpage, false);
+      if (success)
+        {
+          pagedir_set_writable (src->owner->pagedir, src->upage, false);
+          add_page (f, dst);
+          share_cnt++;
+        }
+    }
+  if (success && src->swap_slot != SWAP_NONE)
+    {
+      swap_dup (src->swap_slot);
+      dst->swap_slot = src->swap_slot;
+    }
+  lock_release (&frame_lock);
+
+  return success;
+}
+
+/* Handles a write by its owner to writable page PAGE, which is
+   mapped read-only because its frame is shared: gives PAGE a
+   private copy of the frame, or simply makes it writable if no
+   other page shares the frame any more.  If PAGE has been
+   evicted meanwhile, nothing needs to be done, since the retried
+   access will fault it back in.
+   Returns true if successful, false if no frame could be
+   obtained. */
+bool
+frame_unshare (struct page *page)
+{
+  struct frame *old, *new;
+  uint32_t *pd = page->owner->pagedir;
+  bool was_pinned = page->pinned;
+
+  ASSERT (page->writable);
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (page);
+  old = page->frame;
+  if (old == NULL)
+    {
+      lock_release (&frame_lock);
+      return true;
+    }
+  if (list_size (&old->pages) == 1)
+    {
+      pagedir_set_writable (pd, page->upage, true);
+      lock_release (&frame_lock);
+      return true;
+    }
+
+  /* Keep the shared frame from being chosen to make room for its
+     own copy. */
+  page->pinned = true;
+  new = get_frame ();
+  page->pinned = was_pinned;
+  if (new == NULL)
+    {
+      lock_release (&frame_lock);
+      return false;
+    }
+
+  memcpy (new->kpage, old->kpage, PGSIZE);
+  pagedir_clear_page (pd, page->upage);
+  list_remove (&page->frame_elem);
+  list_push_back (&new->pages, &page->frame_elem);
+  page->frame = new;
+  if (page->swap_slot != SWAP_NONE)
+    {
+      /* The swap copy still belongs to the other pages. */
+      swap_free (page->swap_slot);
+      page->swap_slot = SWAP_NONE;
+    }
+  copy_cnt++;
+
+  /* Cannot fail: the page table for PAGE already exists. */
+  pagedir_set_page (pd, page->upage, new->kpage, true);
+  lock_release (&frame_lock);
+
+  return true;
+}
+
+/* Pins resident PAGE, so that the frame holding it cannot be
+   evicted.
+   Returns true if successful, false if PAGE is not resident. */
+bool
+frame_pin (struct page *page)
+{
+  bool resident;
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (page);
+  resident = page->frame != NULL;
+  if (resident)
+    page->pinned = true;
+  lock_release (&frame_lock);
+
+  return resident;
+}
+
+/* Allows the frame holding PAGE to be evicted again, unless
+   another page in it is pinned. */
+void
+frame_unpin (struct page *page)
+{
+  lock_acquire (&frame_lock);
+  page->pinned = false;
+  lock_release (&frame_lock);
+}
+
+/* Limits the current process to LIMIT resident pages, or removes
+   its limit if LIMIT is 0.  If the process is over a new, lower
+   limit, evicts its own pages until it is within the limit, or
+   until none is left that can be evicted.  The peak RSS that
+   memstat() reports then starts over from the current RSS. */
+void
+frame_set_limit (int limit)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (limit >= 0);
+
+  lock_acquire (&frame_lock);
+  t->rss_limit = limit;
+  while (limit > 0 && t->rss > limit)
+    {
+      struct frame *f = frame_evict_own (t);
+      if (f == NULL)
+        break;
+      free_frame (f);
+    }
+
+  /* getrusage() still reports the peak over the whole run. */
+  if (t->rss_peak > t->usage.peak)
+    t->usage.peak = t->rss_peak;
+  t->rss_peak = t->rss;
+  lock_release (&frame_lock);
+}
+
+/* Fills in *USAGE with the memory use of the current process. */
+void
+frame_get_usage (struct memstat *usage)
+{
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+
+  lock_acquire (&frame_lock);
+  usage->resident = t->rss;
+  usage->peak = t->rss_peak;
+  usage->limit = t->rss_limit;
+  usage->swapped = usage->shared = 0;
+  hash_first (&i, &t->pages);
+  while (hash_next (&i))
+    {
+      struct page *p = hash_entry (hash_cur (&i), struct page, hash_elem);
+      if (p->frame != NULL)
+        {
+          if (list_size (&p->frame->pages) > 1)
+            usage->shared++;
+        }
+      else if (p->swap_slot != SWAP_NONE)
+        usage->swapped++;
+    }
+  lock_release (&frame_lock);
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frame: %lld frames allocated, %lld evictions, "
+          "%lld pages shared, %lld copied on write, "
+          "%lld executable pages shared, "
+          "%lld reclaimed over RSS limit\n",
+          alloc_cnt, evict_cnt, share_cnt, copy_cnt, text_cnt, limit_cnt);
+}
+
+/* Puts page P in frame F and counts it in its owner's RSS.
+   FRAME_LOCK must be held. */
+static void
+add_page (struct frame *f, struct page *p)
+{
+  struct thread *t = p->owner;
+
+  list_push_back (&f->pages, &p->frame_elem);
+  p->frame = f;
+  if (++t->rss > t->rss_peak)
+    t->rss_peak = t->rss;
+}
+
+/* Takes page P out of its frame and its owner's RSS.
+   FRAME_LOCK must be held. */
+static void
+remove_page (struct page *p)
+{
+  list_remove (&p->frame_elem);
+  p->frame = NULL;
+  p->owner->rss--;
+}
+
+/* Removes frame F from the text cache, if it is there.
+   FRAME_LOCK must be held. */
+static void
+release_frame (struct frame *f)
+{
+  if (f->inode != NULL)
+    {
+      hash_delete (&text_cache, &f->text_elem);
+      f->inode = NULL;
+    }
+}
+
+/* Removes frame F, which holds no page, from the frame table and
+   frees it.  FRAME_LOCK must be held. */
+static void
+free_frame (struct frame *f)
+{
+  ASSERT (list_empty (&f->pages));
+
+  release_frame (f);
+  if (clock_hand == &f->elem)
+    clock_hand = list_next (clock_hand);
+  list_remove (&f->elem);
+  frame_cnt--;
+  palloc_free_page (f->kpage);
+  free (f);
+}
+
+/* Waits until PAGE is not in a frame that evict_pages() is
+   writing to swap.  FRAME_LOCK must be held. */
+static void
+wait_for_eviction (struct page *page)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  while (page->frame != NULL && page->frame->evicting)
+    cond_wait (&evict_done, &frame_lock);
+}
+
+/* Returns a frame that holds no page, taking it from the user
+   pool if possible or else by evicting a page.  The caller must
+   put a page in it before releasing FRAME_LOCK.
+   Returns a null pointer if neither works.  FRAME_LOCK must be
+   held; it is released and reacquired if the evicted page must
+   be written to swap. */
+static struct frame *
+get_frame (void)
+{
+  struct frame *f;
+  void *kpage;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  kpage = palloc_get_page (PAL_USER);
+  if (kpage != NULL)
+    {
+      f = malloc (sizeof *f);
+      if (f == NULL)
+        {
+          palloc_free_page (kpage);
+          return NULL;
+        }
+      f->kpage = kpage;
+      f->evicting = false;
+      f->inode = NULL;
+      list_init (&f->pages);
+
+      /* Insert just behind the clock hand, so that the new
+         frame is the last one the clock will look at. */
+      list_insert (clock_hand, &f->elem);
+      frame_cnt++;
+    }
+  else
+    {
+      f = frame_evict ();
+      if (f == NULL)
+        return NULL;
+      evict_cnt++;
+    }
+  alloc_cnt++;
+
+  return f;
+}
+
+/* Returns the frame under the clock hand and advances the
+   hand, wrapping around at the end of the frame table. */
+static struct frame *
+clock_advance (void)
+{
+  struct frame *f;
+
+  if (clock_hand == list_end (&frames))
+    clock_hand = list_begin (&frames);
+  f = list_entry (clock_hand, struct frame, elem);
+  clock_hand = list_next (clock_hand);
+  return f;
+}
+
+/* Returns true if any page held in frame F is pinned. */
+static bool
+frame_is_pinned (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (list_entry (e, struct page, frame_elem)->pinned)
+      return true;
+  return false;
+}
+
+/* Returns true if any page held in frame F has been accessed
+   since the last call, clearing the accessed bits. */
+static bool
+test_and_clear_accessed (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+
+      if (pagedir_is_accessed (pd, p->upage))
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Returns true if frame F must be written to swap before it can
+   be reused. */
+static bool
+frame_is_dirty (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (page_is_dirty (list_entry (e, struct page, frame_elem)))
+      return true;
+  return false;
+}
+
+/* Maps the pages held in frame F again, after evict_pages() has
+   unmapped them, without losing their dirty bits. */
+static void
+remap_pages (struct frame *f)
+{
+  bool shared = list_size (&f->pages) > 1;
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+      bool dirty = pagedir_is_dirty (pd, p->upage);
+
+      /* Cannot fail: the page table for P already exists. */
+      pagedir_set_page (pd, p->upage, f->kpage, p->writable && !shared);
+      if (dirty)
+        pagedir_set_dirty (pd, p->upage, true);
+    }
+}
+
+/* Evicts every page held in frame F, writing the frame to swap
+   if it is dirty.  Pages that share F end up sharing its swap
+   slot.  The frame itself is not freed.
+   FRAME_LOCK is released during the write, with F marked as
+   being evicted.
+   Returns true if successful, false if swap is full. */
+static bool
+evict_pages (struct frame *f)
+{
+  struct page *first = list_entry (list_front (&f->pages),
+                                   struct page, frame_elem);
+  struct list_elem *e;
+  bool dirty;
+
+  /* Unmap the pages before checking whether they are dirty, so
+     that their owners fault instead of modifying the frame
+     behind our back.  Unmapping keeps the dirty bits. */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      pagedir_clear_page (p->owner->pagedir, p->upage);
+    }
+  dirty = frame_is_dirty (f);
+
+  if (dirty && first->swap_slot == SWAP_NONE)
+    {
+      swap_slot_t slot = swap_alloc ();
+      if (slot == SWAP_NONE)
+        {
+          remap_pages (f);
+          return false;
+        }
+      for (e = list_begin (&f->pages); e != list_end (&f->pages);
+           e = list_next (e))
+        {
+          struct page *p = list_entry (e, struct page, frame_elem);
+          if (p != first)
+            swap_dup (slot);
+          p->swap_slot = slot;
+        }
+    }
+
+  release_frame (f);
+  if (dirty)
+    {
+      f->evicting = true;
+      lock_release (&frame_lock);
+      swap_write (first->swap_slot, f->kpage);
+      lock_acquire (&frame_lock);
+      f->evicting = false;
+      cond_broadcast (&evict_done, &frame_lock);
+    }
+
+  while (!list_empty (&f->pages))
+    remove_page (list_entry (list_front (&f->pages),
+                             struct page, frame_elem));
+  return true;
+}
+
+/* Chooses a victim frame with the clock algorithm, writes its
+   pages out and returns the now unused frame.  Recently accessed
+   frames get a second chance, and on the first sweep frames that
+   would have to be written to swap are passed over in favour of
+   clean ones.
+   Returns a null pointer if every frame is pinned or the frame
+   could not be written out.  FRAME_LOCK must be held. */
+static struct frame *
+frame_evict (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  for (i = 0; i < 3 * frame_cnt; i++)
+    {
+      struct frame *f = clock_advance ();
+
+      if (f->evicting || frame_is_pinned (f))
+        continue;
+      if (test_and_clear_accessed (f))
+        continue;
+      if (i < frame_cnt && frame_is_dirty (f))
+        continue;
+
+      if (!evict_pages (f))
+        return NULL;
+      return f;
+    }
+  return NULL;
+}
+
+/* Chooses a victim among the frames that hold a page of T and
+   no other page, preferring one that has not been accessed
+   recently, writes it out and returns the now unused frame.
+   Returns a null pointer if T has no such frame that can be
+   evicted.  FRAME_LOCK must be held. */
+static struct frame *
+frame_evict_own (struct thread *t)
+{
+  struct list_elem *e;
+  int pass;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  for (pass = 0; pass < 2; pass++)
+    for (e = list_begin (&frames); e != list_end (&frames); e = list_next (e))
+      {
+        struct frame *f = list_entry (e, struct frame, elem);
+        struct page *p;
+
+        if (f->evicting || list_size (&f->pages) != 1)
+          continue;
+        p = list_entry (list_front (&f->pages), struct page, frame_elem);
+        if (p->owner != t || p->pinned)
+          continue;
+        if (pass == 0 && test_and_clear_accessed (f))
+          continue;
+
+        if (!evict_pages (f))
+          return NULL;
+        limit_cnt++;
+        return f;
+      }
+  return NULL;
+}
+
+/* Returns a hash value for text cache frame E. */
+static unsigned
+text_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, text_elem);
+  return hash_int ((int) f->inode) ^ hash_int ((int) f->upage);
+}
+
+/* Returns true if text cache frame A precedes frame B. */
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, text_elem);
+  const struct frame *b = hash_entry (b_, struct frame, text_elem);
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  return a->upage < b->upage;
+}
@@ -0,0 +1,41 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+
+struct inode;
+struct memstat;
+struct page;
+
+/* A frame of physical memory from the user pool that holds a
+   user page.  After a fork the same page may be held for several
+   processes at once, read-only, until one of them writes to it. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address of frame. */
+    struct list pages;          /* Pages held in this frame. */
+    struct list_elem elem;      /* Element in frame table. */
+    bool evicting;              /* Being written to swap? */
+
+    /* Set only while the frame is in the text cache. */
+    struct inode *inode;        /* Executable the frame was read from. */
+    void *upage;                /* User virtual address of the page. */
+    struct hash_elem text_elem; /* Element in text cache. */
+  };
+
+void frame_init (void);
+struct frame *frame_alloc (struct page *);
+void frame_free (struct page *);
+bool frame_share (struct page *src, struct page *dst);
+bool frame_unshare (struct page *);
+bool frame_share_text (struct page *);
+void frame_cache_text (struct page *);
+bool frame_pin (struct page *);
+void frame_unpin (struct page *);
+void frame_set_limit (int limit);
+void frame_get_usage (struct memstat *);
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
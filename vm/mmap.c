@@ -0,0 +1,136 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   mmap_create() only records a file-backed page in the
+   supplemental page table for every page of the mapping; the
+   pages are read from the file when they are first touched, and
+   written back only if they were modified, when the mapping is
+   destroyed by munmap or at process exit. */
+
+static void unmap (struct mapping *);
+
+/* Maps FILE into the current process's address space starting
+   at user page ADDR.  The mapping gets its own reopened file, so
+   it stays valid after FILE is closed.
+   Returns the new mapping's identifier, or MAP_FAILED if FILE is
+   empty, ADDR is null or not page-aligned, the mapping would
+   overlap pages already in use or the stack area, or memory
+   allocation fails. */
+mapid_t
+mmap_create (struct file *file, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct mapping *m;
+  off_t length = file_length (file);
+  size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+  uint8_t *upage = addr;
+  size_t i;
+
+  if (addr == NULL || pg_ofs (addr) != 0 || length == 0)
+    return MAP_FAILED;
+
+  /* The mapping must lie entirely below the area reserved for
+     stack growth and must not overlap any existing page. */
+  if (upage >= (uint8_t *) PHYS_BASE - STACK_MAX
+      || (size_t) length > (size_t) ((uint8_t *) PHYS_BASE - STACK_MAX - upage))
+    return MAP_FAILED;
+  for (i = 0; i < page_cnt; i++)
+    if (page_lookup (upage + i * PGSIZE) != NULL
+        || pagedir_get_page (t->pagedir, upage + i * PGSIZE) != NULL)
+      return MAP_FAILED;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->file = file_reopen (file);
+  if (m->file == NULL)
+    {
+      free (m);
+      return MAP_FAILED;
+    }
+  m->addr = addr;
+  m->page_cnt = 0;
+
+  /* Add a file-backed page for every page of the file. */
+  for (i = 0; i < page_cnt; i++)
+    {
+      off_t ofs = i * PGSIZE;
+      struct page *p = page_create (upage + ofs, true);
+      if (p == NULL)
+        {
+          unmap (m);
+          return MAP_FAILED;
+        }
+      p->file = m->file;
+      p->file_ofs = ofs;
+      p->read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+      m->page_cnt++;
+    }
+
+  m->id = t->next_mapid++;
+  list_push_back (&t->mappings, &m->elem);
+  return m->id;
+}
+
+/* Unmaps the current process's mapping with identifier ID,
+   writing modified pages back to the file.
+   Returns true if successful, false if there is no such
+   mapping. */
+bool
+mmap_destroy (mapid_t id)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mappings); e != list_end (&t->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        {
+          list_remove (&m->elem);
+          unmap (m);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Unmaps all of the current process's mappings. */
+void
+mmap_destroy_all (void)
+{
+  struct thread *t = thread_current ();
+
+  while (!list_empty (&t->mappings))
+    {
+      struct list_elem *e = list_pop_front (&t->mappings);
+      unmap (list_entry (e, struct mapping, elem));
+    }
+}
+
+/* Removes M's pages, writing modified ones back, then closes
+   M's file and frees M. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      struct page *p = page_lookup ((uint8_t *) m->addr + i * PGSIZE);
+      ASSERT (p != NULL && p->file == m->file);
+      page_remove (p);
+    }
+  file_close (m->file);
+  free (m);
+}
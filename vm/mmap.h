@@ -0,0 +1,28 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct file;
+
+/* Map region identifier. */
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t) -1)
+
+/* A memory-mapped file. */
+struct mapping
+  {
+    mapid_t id;                 /* Mapping identifier. */
+    struct file *file;          /* File, reopened for the mapping. */
+    void *addr;                 /* First mapped user page. */
+    size_t page_cnt;            /* Number of mapped pages. */
+    struct list_elem elem;      /* Element in owner's mapping list. */
+  };
+
+mapid_t mmap_create (struct file *, void *addr);
+bool mmap_destroy (mapid_t);
+void mmap_destroy_all (void);
+
+#endif /* vm/mmap.h */
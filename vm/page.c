@@ -0,0 +1,323 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+
+/* Supplemental page table.
+
+   Each process keeps a hash table of `struct page', one for
+   every page of its user address space, keyed by user virtual
+   address.  It records where each page's contents are when the
+   page is not in memory, so that page_fault_in() can bring it
+   back after the frame table has evicted it. */
+
+static unsigned page_hash (const struct hash_elem *, void *);
+static bool page_less (const struct hash_elem *, const struct hash_elem *,
+                       void *);
+static void page_destroy (struct hash_elem *, void *);
+
+/* Initializes the current process's supplemental page table.
+   Returns true if successful, false if memory allocation
+   fails. */
+bool
+page_table_init (void)
+{
+  return hash_init (&thread_current ()->pages, page_hash, page_less, NULL);
+}
+
+/* Destroys the current process's supplemental page table,
+   freeing every frame and swap slot that its pages use.
+   Must be called before the process's page directory is
+   destroyed. */
+void
+page_table_destroy (void)
+{
+  hash_destroy (&thread_current ()->pages, page_destroy);
+}
+
+/* Fills the current process's empty page table with a copy of
+   PARENT's, for fork.  Pages are shared copy-on-write rather
+   than copied; memory-mapped files are not inherited.  The
+   current process's executable must already be open, since
+   executable pages are read from it.
+   Returns true if successful, false if memory allocation
+   fails. */
+bool
+page_table_copy (struct thread *parent)
+{
+  struct hash_iterator i;
+
+  hash_first (&i, &parent->pages);
+  while (hash_next (&i))
+    {
+      struct page *src = hash_entry (hash_cur (&i), struct page, hash_elem);
+      struct page *dst;
+
+      if (src->file != NULL && !page_is_text (src))
+        continue;
+
+      dst = page_create (src->upage, src->writable);
+      if (dst == NULL)
+        return false;
+      if (page_is_text (src))
+        {
+          dst->file = thread_current ()->exec_file;
+          dst->file_ofs = src->file_ofs;
+          dst->read_bytes = src->read_bytes;
+        }
+      if (!frame_share (src, dst))
+        return false;
+    }
+  return true;
+}
+
+/* Adds a page at user virtual address UPAGE to the current
+   process's page table.  The page starts out not resident and
+   zero-filled.
+   Returns the new page, or a null pointer if UPAGE is already in
+   the table or memory allocation fails. */
+struct page *
+page_create (void *upage, bool writable)
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+
+  p->upage = upage;
+  p->owner = t;
+  p->writable = writable;
+  p->frame = NULL;
+  p->pinned = false;
+  p->swap_slot = SWAP_NONE;
+  p->file = NULL;
+  p->file_ofs = 0;
+  p->read_bytes = 0;
+  if (hash_insert (&t->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Returns the current process's page that contains user virtual
+   address UADDR, or a null pointer if there is none. */
+struct page *
+page_lookup (const void *uaddr)
+{
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (uaddr);
+  e = hash_find (&thread_current ()->pages, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Removes page P from the current process's page table and
+   frees it.  A file-backed page that has been modified is
+   written back to its file first. */
+void
+page_remove (struct page *p)
+{
+  if (p->file != NULL)
+    {
+      /* A file-backed page only gets a swap slot when it is
+         evicted dirty. */
+      bool modified;
+      if (frame_pin (p))
+        modified = (p->swap_slot != SWAP_NONE
+                    || pagedir_is_dirty (p->owner->pagedir, p->upage));
+      else
+        modified = p->swap_slot != SWAP_NONE && page_in (p);
+
+      if (modified)
+        file_write_at (p->file, p->frame->kpage, p->read_bytes, p->file_ofs);
+    }
+
+  hash_delete (&thread_current ()->pages, &p->hash_elem);
+  page_destroy (&p->hash_elem, NULL);
+}
+
+/* Brings non-resident page P into a frame and maps it into its
+   owner's page directory.  The frame stays pinned until
+   page_unpin() is called, so that the caller may finish
+   initializing it through P->frame->kpage.
+   Returns true if successful, false if no frame could be
+   obtained. */
+bool
+page_in (struct page *p)
+{
+  return page_in_from (p, NULL);
+}
+
+/* Like page_in(), except that if P's contents would be read from
+   its file, the P->read_bytes bytes at DATA, if non-null, are
+   used instead.  This lets a caller that has already read the
+   file, such as the loader, avoid reading it again. */
+bool
+page_in_from (struct page *p, const void *data)
+{
+  struct frame *f;
+
+  if (page_is_text (p) && frame_share_text (p))
+    return true;
+
+  /* frame_alloc() puts P in the frame. */
+  f = frame_alloc (p);
+  if (f == NULL)
+    return false;
+
+  if (p->swap_slot != SWAP_NONE)
+    {
+      swap_read (p->swap_slot, f->kpage);
+
+      /* A slot shared with a forked process must not be
+         overwritten, so give it up and treat the page as
+         dirty. */
+      if (swap_unshare (p->swap_slot))
+        p->swap_slot = SWAP_NONE;
+    }
+  else if (p->file != NULL)
+    {
+      off_t read_bytes;
+      if (data != NULL)
+        {
+          memcpy (f->kpage, data, p->read_bytes);
+          read_bytes = p->read_bytes;
+        }
+      else
+        read_bytes = file_read_at (p->file, f->kpage,
+                                   p->read_bytes, p->file_ofs);
+      memset ((uint8_t *) f->kpage + read_bytes, 0, PGSIZE - read_bytes);
+    }
+  else
+    memset (f->kpage, 0, PGSIZE);
+
+  if (!pagedir_set_page (p->owner->pagedir, p->upage, f->kpage, p->writable))
+    {
+      frame_free (p);
+      return false;
+    }
+  if (page_is_text (p))
+    frame_cache_text (p);
+  return true;
+}
+
+/* Returns true if P is a read-only page of the process's
+   executable, which may be shared with other processes running
+   the same executable.  Pages of memory-mapped files are always
+   writable. */
+bool
+page_is_text (const struct page *p)
+{
+  return p->file != NULL && !p->writable;
+}
+
+/* Allows resident page P to be evicted again. */
+void
+page_unpin (struct page *p)
+{
+  frame_unpin (p);
+}
+
+/* Returns true if resident page P must be written to swap before
+   its frame can be reused, that is, if it has been modified
+   since it was last read in, or if there is no other copy of it
+   to read it back from. */
+bool
+page_is_dirty (struct page *p)
+{
+  ASSERT (p->frame != NULL);
+  return (pagedir_is_dirty (p->owner->pagedir, p->upage)
+          || (p->swap_slot == SWAP_NONE && p->file == NULL));
+}
+
+/* Handles a not-present page fault at FAULT_ADDR by the current
+   process, whose user stack pointer is ESP.  Brings in the page
+   if the process has one at FAULT_ADDR, or adds a new stack page
+   if the access looks like a push just below the stack.
+   Returns true if the fault was resolved, false if the access
+   was invalid. */
+bool
+page_fault_in (void *fault_addr, void *esp)
+{
+  struct page *p;
+
+  if (thread_current ()->pagedir == NULL || !is_user_vaddr (fault_addr))
+    return false;
+
+  p = page_lookup (fault_addr);
+  if (p == NULL)
+    {
+      /* PUSHA faults up to 32 bytes below the stack pointer. */
+      if ((uint8_t *) fault_addr < (uint8_t *) PHYS_BASE - STACK_MAX
+          || (uint8_t *) fault_addr < (uint8_t *) esp - 32)
+        return false;
+      p = page_create (pg_round_down (fault_addr), true);
+      if (p == NULL)
+        return false;
+    }
+
+  if (!page_in (p))
+    return false;
+  page_unpin (p);
+  return true;
+}
+
+/* Handles a write fault at FAULT_ADDR by the current process to
+   a page that is present but read-only, which is legal if the
+   page is writable and only mapped read-only because it is
+   shared with a forked process.
+   Returns true if the fault was resolved, false if the access
+   was invalid. */
+bool
+page_fault_cow (void *fault_addr)
+{
+  struct page *p;
+
+  if (thread_current ()->pagedir == NULL || !is_user_vaddr (fault_addr))
+    return false;
+
+  p = page_lookup (fault_addr);
+  return p != NULL && p->writable && frame_unshare (p);
+}
+
+/* Returns a hash value for page E. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_int ((int) pg_no (p->upage));
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Frees page E along with its frame and swap slot. */
+static void
+page_destroy (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *p = hash_entry (e, struct page, hash_elem);
+
+  frame_free (p);
+  if (p->swap_slot != SWAP_NONE)
+    swap_free (p->swap_slot);
+  free (p);
+}
@@ -0,0 +1,60 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/thread.h"
+#include "userprog/layout.h"
+#include "vm/swap.h"
+
+/* A user virtual page, as recorded in its process's
+   supplemental page table.
+
+   A page is either resident in FRAME, or it is not resident
+   and its contents are in SWAP_SLOT or, if it has no swap slot,
+   in FILE (READ_BYTES bytes at FILE_OFS followed by zeros) or,
+   if it has no file either, all zeros.  A resident page may
+   also keep a swap slot whose contents are up to date as long
+   as the page is not dirty.  After a fork, parent and child
+   pages may share a frame or a swap slot, and read-only pages
+   of an executable are shared by every process running it (see
+   vm/frame.c).
+
+   A file-backed page that is modified goes to swap when it is
+   evicted; it is only written back to FILE when it is
+   removed. */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    struct thread *owner;       /* Process that owns the page. */
+    bool writable;              /* Writable by the user? */
+
+    struct frame *frame;        /* Frame holding the page, or null. */
+    struct list_elem frame_elem; /* Element in frame's page list. */
+    bool pinned;                /* True: frame may not be evicted. */
+    swap_slot_t swap_slot;      /* Swap slot, or SWAP_NONE. */
+
+    struct file *file;          /* Backing file, or null. */
+    off_t file_ofs;             /* Offset of page in FILE. */
+    size_t read_bytes;          /* Bytes to read from FILE. */
+
+    struct hash_elem hash_elem; /* Element in owner's page table. */
+  };
+
+bool page_table_init (void);
+bool page_table_copy (struct thread *parent);
+void page_table_destroy (void);
+
+struct page *page_create (void *upage, bool writable);
+struct page *page_lookup (const void *uaddr);
+void page_remove (struct page *);
+bool page_in (struct page *);
+bool page_in_from (struct page *, const void *data);
+void page_unpin (struct page *);
+bool page_is_dirty (struct page *);
+bool page_is_text (const struct page *);
+bool page_fault_in (void *fault_addr, void *esp);
+bool page_fault_cow (void *fault_addr);
+
+#endif /* vm/page.h */
@@ -0,0 +1,137 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.  The swap disk (hd1:1, see disk_get()) is divided
+   into page-sized slots of PAGE_SECTORS consecutive sectors, and
+   SWAP_MAP has one bit per slot telling whether it is in use.
+
+   After a fork, the pages of parent and child may refer to the
+   same slot, so SWAP_REFS counts the pages that use each slot and
+   a slot is only released when the last of them lets go. */
+
+/* Number of sectors in a page. */
+#define PAGE_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+static struct disk *swap_disk;  /* Swap disk, or null if none. */
+static struct bitmap *swap_map; /* Used slots. */
+static unsigned short *swap_refs; /* Number of users of each slot. */
+static struct lock swap_lock;   /* Protects SWAP_MAP and SWAP_REFS. */
+
+/* Statistics. */
+static long long swap_read_cnt;         /* # of pages read in. */
+static long long swap_write_cnt;        /* # of pages written out. */
+
+/* Initializes the swap disk. */
+void
+swap_init (void)
+{
+  size_t slot_cnt = 0;
+
+  swap_disk = disk_get (1, 1);
+  if (swap_disk != NULL)
+    slot_cnt = disk_size (swap_disk) / PAGE_SECTORS;
+  else
+    printf ("hd1:1 (hdd) not present, swapping disabled\n");
+
+  swap_map = bitmap_create (slot_cnt);
+  swap_refs = calloc (slot_cnt + 1, sizeof *swap_refs);
+  if (swap_map == NULL || swap_refs == NULL)
+    PANIC ("swap bitmap creation failed--disk is too large");
+  lock_init (&swap_lock);
+}
+
+/* Allocates a free swap slot and returns it.
+   Returns SWAP_NONE if the swap disk is full or missing. */
+swap_slot_t
+swap_alloc (void)
+{
+  size_t slot;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (swap_map, 0, 1, false);
+  if (slot != BITMAP_ERROR)
+    swap_refs[slot] = 1;
+  lock_release (&swap_lock);
+
+  return slot != BITMAP_ERROR ? slot : SWAP_NONE;
+}
+
+/* Adds another user to SLOT, which must be in use. */
+void
+swap_dup (swap_slot_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  swap_refs[slot]++;
+  lock_release (&swap_lock);
+}
+
+/* Drops one user of SLOT, making it available for reuse once
+   there are none left. */
+void
+swap_free (swap_slot_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  if (--swap_refs[slot] == 0)
+    bitmap_reset (swap_map, slot);
+  lock_release (&swap_lock);
+}
+
+/* If SLOT has more than one user, drops one of them and returns
+   true; the caller must then stop using SLOT.  Returns false,
+   leaving SLOT alone, if the caller is its only user. */
+bool
+swap_unshare (swap_slot_t slot)
+{
+  bool shared;
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  shared = swap_refs[slot] > 1;
+  if (shared)
+    swap_refs[slot]--;
+  lock_release (&swap_lock);
+
+  return shared;
+}
+
+/* Reads the page stored in SLOT into KPAGE. */
+void
+swap_read (swap_slot_t slot, void *kpage)
+{
+  size_t i;
+
+  ASSERT (bitmap_test (swap_map, slot));
+  for (i = 0; i < PAGE_SECTORS; i++)
+    disk_read (swap_disk, slot * PAGE_SECTORS + i,
+               (uint8_t *) kpage + i * DISK_SECTOR_SIZE);
+  swap_read_cnt++;
+}
+
+/* Writes the page at KPAGE into SLOT. */
+void
+swap_write (swap_slot_t slot, const void *kpage)
+{
+  size_t i;
+
+  ASSERT (bitmap_test (swap_map, slot));
+  for (i = 0; i < PAGE_SECTORS; i++)
+    disk_write (swap_disk, slot * PAGE_SECTORS + i,
+                (const uint8_t *) kpage + i * DISK_SECTOR_SIZE);
+  swap_write_cnt++;
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %lld pages read, %lld pages written\n",
+          swap_read_cnt, swap_write_cnt);
+}
@@ -0,0 +1,20 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Index of a page-sized slot on the swap disk. */
+typedef size_t swap_slot_t;
+#define SWAP_NONE ((swap_slot_t) -1)    /* No slot. */
+
+void swap_init (void);
+swap_slot_t swap_alloc (void);
+void swap_dup (swap_slot_t);
+void swap_free (swap_slot_t);
+bool swap_unshare (swap_slot_t);
+void swap_read (swap_slot_t, void *kpage);
+void swap_write (swap_slot_t, const void *kpage);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */